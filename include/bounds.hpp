@@ -0,0 +1,118 @@
+
+#ifndef _GLIMPLIFY_BOUNDS_H_
+#define _GLIMPLIFY_BOUNDS_H_
+
+#include <glm/glm.hpp>
+
+namespace glimplify {
+
+	// how clip space depth maps to the depth buffer, see context::reverse_depth()
+	enum class depth_convention
+	{
+		// gl default, ndc z in [-1, 1], near is depth 0, farther is larger
+		standard,
+		// glClipControl zero to one, near is depth 1, far or infinity is 0, farther is smaller
+		reverse
+	};
+
+	struct bounding_sphere
+	{
+		glm::vec3 center;
+		float radius;
+	};
+
+	struct bounding_box
+	{
+		glm::vec3 min;
+		glm::vec3 max;
+
+		glm::vec3 center() const
+		{
+			return (min + max) * 0.5f;
+		}
+
+		glm::vec3 extent() const
+		{
+			return (max - min) * 0.5f;
+		}
+	};
+
+	/*
+	*
+	* Six planes (left, right, bottom, top, near, far) pointing inside, xyz normalized, so
+	* dot(plane.xyz, p) + plane.w is the signed distance of p. Extracted from a projection * view matrix
+	* (Gribb & Hartmann), in world space for projection * view, in view space for a projection alone.
+	* An infinite far plane becomes (0, 0, 0, 1), which everything is inside of.
+	*
+	*/
+
+	struct frustum
+	{
+		glm::vec4 planes[6];
+
+		static frustum from_matrix(const glm::mat4& clip, depth_convention depth = depth_convention::standard)
+		{
+			// glm is column major, row i of the matrix is (clip[0][i], clip[1][i], clip[2][i], clip[3][i])
+			glm::vec4 x(clip[0][0], clip[1][0], clip[2][0], clip[3][0]);
+			glm::vec4 y(clip[0][1], clip[1][1], clip[2][1], clip[3][1]);
+			glm::vec4 z(clip[0][2], clip[1][2], clip[2][2], clip[3][2]);
+			glm::vec4 w(clip[0][3], clip[1][3], clip[2][3], clip[3][3]);
+
+			frustum res;
+			res.planes[0] = w + x;
+			res.planes[1] = w - x;
+			res.planes[2] = w + y;
+			res.planes[3] = w - y;
+			if (depth_convention::standard == depth)
+			{
+				res.planes[4] = w + z;
+				res.planes[5] = w - z;
+			}
+			else
+			{
+				// 0 <= z <= w, the near plane is at z = w
+				res.planes[4] = w - z;
+				res.planes[5] = z;
+			}
+
+			for (glm::vec4& plane : res.planes)
+			{
+				float length = glm::length(glm::vec3(plane));
+				plane = length > 0.0f ? plane / length : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+			}
+
+			return res;
+		}
+
+		bool intersects(const bounding_sphere& sphere) const
+		{
+			for (const glm::vec4& plane : planes)
+			{
+				if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		// conservative, boxes near a frustum corner may pass without touching it
+		bool intersects(const bounding_box& box) const
+		{
+			glm::vec3 center = box.center();
+			glm::vec3 extent = box.extent();
+			for (const glm::vec4& plane : planes)
+			{
+				glm::vec3 normal(plane);
+				float radius = glm::dot(extent, glm::abs(normal));
+				if (glm::dot(normal, center) + plane.w < -radius)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+	};
+};
+
+#endif
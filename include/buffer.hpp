@@ -0,0 +1,155 @@
+
+#ifndef _GLIMPLIFY_BUFFER_H_
+#define _GLIMPLIFY_BUFFER_H_
+
+#include "capabilities.hpp"
+
+namespace glimplify {
+
+	class buffer
+	{
+		bool _dsa;
+
+		GLuint _id;
+		GLsizeiptr _size;
+
+		static GLbitfield storage_flags(GLenum usage)
+		{
+			// update() works on any buffer, like glBufferSubData on mutable storage, static usage is only a hint
+			(void)usage;
+			return GL_DYNAMIC_STORAGE_BIT;
+		}
+
+	public:
+		buffer()
+			: _dsa(capabilities::current().direct_state_access()), _id(0), _size(0)
+		{
+			if (_dsa)
+			{
+				glCreateBuffers(1, &_id);
+			}
+			else
+			{
+				glGenBuffers(1, &_id);
+			}
+		}
+
+		GLuint id() const
+		{
+			return _id;
+		}
+
+		GLsizeiptr size() const
+		{
+			return _size;
+		}
+
+		void bind(GLenum target)
+		{
+			glBindBuffer(target, _id);
+		}
+
+		// indexed binding point of GL_SHADER_STORAGE_BUFFER, GL_UNIFORM_BUFFER, GL_ATOMIC_COUNTER_BUFFER, ...
+		void bind_base(GLenum target, GLuint index)
+		{
+			glBindBufferBase(target, index, _id);
+		}
+
+		void bind_range(GLenum target, GLuint index, GLintptr offset, GLsizeiptr size)
+		{
+			glBindBufferRange(target, index, _id, offset, size);
+		}
+
+		// target is only used by the bind-to-edit path, returns true when the buffer object got a new id
+		bool allocate(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+		{
+			bool recreated = false;
+
+			if (_dsa)
+			{
+				// immutable storage can not be resized, a second allocation needs a fresh buffer object
+				if (_size > 0)
+				{
+					glDeleteBuffers(1, &_id);
+					glCreateBuffers(1, &_id);
+					recreated = true;
+				}
+
+				if (size > 0)
+				{
+					glNamedBufferStorage(_id, size, data, storage_flags(usage));
+				}
+			}
+			else
+			{
+				glBindBuffer(target, _id);
+				glBufferData(target, size, data, usage);
+			}
+
+			_size = size;
+
+			return recreated;
+		}
+
+		// any buffer, immutable storage is always created with GL_DYNAMIC_STORAGE_BIT
+		void update(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+		{
+			if (_dsa)
+			{
+				glNamedBufferSubData(_id, offset, size, data);
+			}
+			else
+			{
+				glBindBuffer(target, _id);
+				glBufferSubData(target, offset, size, data);
+			}
+		}
+
+		// read back to the cpu, waits for the gpu to finish writing the buffer
+		void read(GLenum target, GLintptr offset, GLsizeiptr size, void* data) const
+		{
+			if (_dsa)
+			{
+				glGetNamedBufferSubData(_id, offset, size, data);
+			}
+			else
+			{
+				glBindBuffer(target, _id);
+				glGetBufferSubData(target, offset, size, data);
+			}
+		}
+
+		// gpu side copy from another buffer, source and destination ranges must not overlap
+		void copy(const buffer& source, GLintptr read_offset, GLintptr write_offset, GLsizeiptr size)
+		{
+			if (_dsa)
+			{
+				glCopyNamedBufferSubData(source._id, _id, read_offset, write_offset, size);
+			}
+			else
+			{
+				glBindBuffer(GL_COPY_READ_BUFFER, source._id);
+				glBindBuffer(GL_COPY_WRITE_BUFFER, _id);
+				glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, read_offset, write_offset, size);
+			}
+		}
+
+		void unbind(GLenum target)
+		{
+			glBindBuffer(target, 0);
+		}
+
+		~buffer()
+		{
+			glDeleteBuffers(1, &_id);
+		}
+
+	private:
+		buffer(const buffer&) = delete;
+		buffer& operator=(const buffer&) = delete;
+		buffer(buffer&&) = delete;
+		buffer&& operator=(buffer&&) = delete;
+	};
+};
+
+#endif
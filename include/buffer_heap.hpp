@@ -0,0 +1,293 @@
+
+#ifndef _GLIMPLIFY_BUFFER_HEAP_H_
+#define _GLIMPLIFY_BUFFER_HEAP_H_
+
+#include "buffer.hpp"
+#include "range_allocator.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace glimplify {
+
+	/*
+	*
+	* Suballocates vertex or index data for many small meshes out of a few large gl buffers (pages).
+	* Sizes and offsets are counted in units: the vertex stride for a vertex heap, the index size for an index heap,
+	* so an allocation offset is directly the baseVertex or firstIndex of a draw:
+	*
+	*     glimplify::buffer_heap vertex_heap(vertex_layout::stride(), 1 << 20);
+	*     glimplify::buffer_heap index_heap(sizeof(GLushort), 1 << 22);
+	*
+	*     glimplify::buffer_heap::handle v = vertex_heap.allocate(vertex_count, vertex_data);
+	*     glimplify::buffer_heap::handle i = index_heap.allocate(index_count, index_data);
+	*
+	*     format.bind_vertices(0, vertex_heap.page(vertex_heap.page_of(v)));
+	*     format.bind_index(index_heap.page(index_heap.page_of(i)));
+	*     glDrawElementsBaseVertex(GL_TRIANGLES, index_count, GL_UNSIGNED_SHORT, (const void*)index_heap.byte_offset(i), vertex_heap.base_vertex(v));
+	*
+	* Handles stay valid across defragment(), offsets and page buffer ids do not, so look them up when drawing.
+	*
+	*/
+
+	class buffer_heap
+	{
+	public:
+		using handle = GLuint;
+
+		static const handle invalid = 0xFFFFFFFF;
+
+	private:
+		struct heap_page
+		{
+			std::unique_ptr<buffer> storage;
+			range_allocator allocator;
+
+			explicit heap_page(GLuint units)
+				: storage(new buffer()), allocator(units)
+			{
+			}
+		};
+
+		struct entry
+		{
+			GLuint page;
+			GLuint node;
+			GLuint offset;
+			GLuint count;
+		};
+
+		GLsizei _unit;
+		GLuint _page_units;
+
+		std::vector<std::unique_ptr<heap_page>> _pages;
+
+		std::vector<entry> _entries;
+		std::vector<handle> _unused_handles;
+
+		heap_page& add_page(GLuint units)
+		{
+			_pages.emplace_back(new heap_page(units));
+
+			heap_page& res = *_pages.back();
+			// the heap is written after creation, so the storage is always dynamic
+			res.storage->allocate(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(units) * _unit, nullptr, GL_DYNAMIC_DRAW);
+
+			return res;
+		}
+
+	public:
+		// unit: bytes per element, page_units: elements per page, larger allocations get a dedicated page
+		explicit buffer_heap(GLsizei unit, GLuint page_units)
+			: _unit(unit), _page_units(page_units)
+		{
+		}
+
+		handle allocate(GLuint count, const void* data = nullptr)
+		{
+			if (0 == count)
+			{
+				return invalid;
+			}
+
+			GLuint page_index = 0;
+			GLuint node = range_allocator::invalid;
+
+			for (; page_index < _pages.size() && range_allocator::invalid == node; ++page_index)
+			{
+				node = _pages[page_index]->allocator.allocate(count);
+			}
+
+			if (range_allocator::invalid == node)
+			{
+				// a fresh page is one free block, taking it from offset 0 can't fail on the size class rounding
+				page_index = static_cast<GLuint>(_pages.size());
+				node = add_page(std::max(count, _page_units)).allocator.allocate_at(0, count);
+			}
+			else
+			{
+				--page_index;
+			}
+
+			if (range_allocator::invalid == node)
+			{
+				return invalid;
+			}
+
+			entry e = { page_index, node, _pages[page_index]->allocator.offset(node), count };
+
+			handle res = invalid;
+			if (!_unused_handles.empty())
+			{
+				res = _unused_handles.back();
+				_unused_handles.pop_back();
+				_entries[res] = e;
+			}
+			else
+			{
+				res = static_cast<handle>(_entries.size());
+				_entries.push_back(e);
+			}
+
+			if (data)
+			{
+				update(res, data, 0, count);
+			}
+
+			return res;
+		}
+
+		void free(handle h)
+		{
+			entry& e = _entries[h];
+			_pages[e.page]->allocator.free(e.node);
+			e.count = 0;
+
+			_unused_handles.push_back(h);
+		}
+
+		// write `count` elements starting at element `first` of the allocation
+		void update(handle h, const void* data, GLuint first, GLuint count)
+		{
+			const entry& e = _entries[h];
+			_pages[e.page]->storage->update(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(e.offset + first) * _unit, static_cast<GLsizeiptr>(count) * _unit, data);
+		}
+
+		GLuint page_of(handle h) const
+		{
+			return _entries[h].page;
+		}
+
+		GLuint count(handle h) const
+		{
+			return _entries[h].count;
+		}
+
+		// the baseVertex of a vertex heap allocation
+		GLint base_vertex(handle h) const
+		{
+			return static_cast<GLint>(_entries[h].offset);
+		}
+
+		// the firstIndex of an index heap allocation, e.g. in DrawElementsIndirectCommand
+		GLuint first_index(handle h) const
+		{
+			return _entries[h].offset;
+		}
+
+		GLintptr byte_offset(handle h) const
+		{
+			return static_cast<GLintptr>(_entries[h].offset) * _unit;
+		}
+
+		GLsizei unit() const
+		{
+			return _unit;
+		}
+
+		GLuint page_count() const
+		{
+			return static_cast<GLuint>(_pages.size());
+		}
+
+		const buffer& page(GLuint index) const
+		{
+			return *_pages[index]->storage;
+		}
+
+		// free elements that can not be used by one allocation because they are split into several blocks
+		GLuint fragmented(GLuint index) const
+		{
+			const range_allocator& allocator = _pages[index]->allocator;
+			return allocator.available() - allocator.largest_free();
+		}
+
+		/*
+		*
+		* Pack the live allocations of every fragmented page to its front. glCopyBufferSubData can not copy
+		* between overlapping ranges of one buffer, so the page is copied into a new buffer that replaces it.
+		* Must not be called while the gpu may still read the old pages, handles keep working.
+		*
+		*/
+		void defragment()
+		{
+			for (GLuint index = 0; index < _pages.size(); ++index)
+			{
+				if (0 == fragmented(index))
+				{
+					continue;
+				}
+
+				heap_page& p = *_pages[index];
+
+				std::vector<handle> live;
+				for (handle h = 0; h < _entries.size(); ++h)
+				{
+					if (_entries[h].count > 0 && index == _entries[h].page)
+					{
+						live.push_back(h);
+					}
+				}
+
+				std::sort(live.begin(), live.end(), [this](handle a, handle b) {
+					return _entries[a].offset < _entries[b].offset;
+				});
+
+				// packed offsets are a running sum, placed exactly, allocate() could round a request past the tail
+				std::vector<GLuint> offsets(live.size());
+				std::uint64_t end = 0;
+				for (size_t i = 0; i < live.size(); ++i)
+				{
+					offsets[i] = static_cast<GLuint>(end);
+					end += _entries[live[i]].count;
+				}
+
+				// nothing is touched unless every range is placed, tried on a scratch allocator first
+				range_allocator scratch(p.allocator.capacity());
+				bool placed = end <= p.allocator.capacity();
+				for (size_t i = 0; i < live.size() && placed; ++i)
+				{
+					placed = range_allocator::invalid != scratch.allocate_at(offsets[i], _entries[live[i]].count);
+				}
+
+				if (!placed)
+				{
+					continue;
+				}
+
+				std::unique_ptr<buffer> packed(new buffer());
+				packed->allocate(GL_COPY_WRITE_BUFFER, p.storage->size(), nullptr, GL_DYNAMIC_DRAW);
+
+				p.allocator.reset();
+				for (size_t i = 0; i < live.size(); ++i)
+				{
+					entry& e = _entries[live[i]];
+
+					GLuint node = p.allocator.allocate_at(offsets[i], e.count);
+
+					packed->copy(*p.storage, static_cast<GLintptr>(e.offset) * _unit, static_cast<GLintptr>(offsets[i]) * _unit, static_cast<GLsizeiptr>(e.count) * _unit);
+
+					e.node = node;
+					e.offset = offsets[i];
+				}
+
+				p.storage.swap(packed);
+			}
+		}
+
+		~buffer_heap()
+		{
+		}
+
+	private:
+		buffer_heap() = delete;
+		buffer_heap(const buffer_heap&) = delete;
+		buffer_heap& operator=(const buffer_heap&) = delete;
+		buffer_heap(buffer_heap&&) = delete;
+		buffer_heap&& operator=(buffer_heap&&) = delete;
+	};
+};
+
+#endif
@@ -0,0 +1,527 @@
+
+#ifndef _GLIMPLIFY_BVH_H_
+#define _GLIMPLIFY_BVH_H_
+
+#include "bounds.hpp"
+#include "camera.hpp"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <utility>
+#include <vector>
+
+namespace glimplify {
+
+	/*
+	*
+	* Bounding volume hierarchy over object boxes, built with the binned surface area heuristic.
+	* Nodes are stored depth first in one array, 32 bytes each: the left child of a node is the next node,
+	* `skip` is the node after its subtree (so the right child is the skip of the left one) and the objects of
+	* every subtree are one contiguous range, so a subtree that is completely inside a query is accepted without
+	* visiting its nodes.
+	*
+	*     glimplify::bvh scene;
+	*     scene.build(boxes.data(), boxes.size());
+	*     ...
+	*     scene.update(id, moved_box);     // for every object that moved
+	*     scene.refit();                   // once per frame, keeps the tree, rebuild now and then after large motion
+	*     scene.query(camera, visible_ids);
+	*
+	*/
+
+	class bvh
+	{
+		struct node
+		{
+			glm::vec3 min;
+			GLuint skip;
+			glm::vec3 max;
+			GLuint first;
+		};
+
+		static const GLuint leaf_size = 4;
+		static const GLuint bins = 12;
+
+		std::vector<node> _nodes;
+		// object ids in tree order
+		std::vector<GLuint> _objects;
+		std::vector<bounding_box> _boxes;
+		// box centers, only used while building
+		std::vector<glm::vec3> _centers;
+
+		static float area(const glm::vec3& min, const glm::vec3& max)
+		{
+			glm::vec3 d = glm::max(max - min, glm::vec3(0.0f));
+			return d.x * d.y + d.y * d.z + d.z * d.x;
+		}
+
+		static void grow(glm::vec3& min, glm::vec3& max, const bounding_box& box)
+		{
+			min = glm::min(min, box.min);
+			max = glm::max(max, box.max);
+		}
+
+		GLuint count(GLuint index) const
+		{
+			GLuint skip = _nodes[index].skip;
+			GLuint end = skip < _nodes.size() ? _nodes[skip].first : static_cast<GLuint>(_objects.size());
+			return end - _nodes[index].first;
+		}
+
+		bool leaf(GLuint index) const
+		{
+			return _nodes[index].skip == index + 1;
+		}
+
+		// returns the split position in [first, first + size), or first when the range should stay a leaf
+		GLuint split(GLuint first, GLuint size, const glm::vec3& min, const glm::vec3& max)
+		{
+			glm::vec3 centroid_min(FLT_MAX), centroid_max(-FLT_MAX);
+			for (GLuint i = first; i < first + size; ++i)
+			{
+				const glm::vec3& c = _centers[_objects[i]];
+				centroid_min = glm::min(centroid_min, c);
+				centroid_max = glm::max(centroid_max, c);
+			}
+
+			float best_cost = FLT_MAX;
+			int best_axis = -1;
+			GLuint best_bin = 0;
+
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				float extent = centroid_max[axis] - centroid_min[axis];
+				if (extent <= 0.0f)
+				{
+					continue;
+				}
+
+				GLuint bin_count[bins] = {};
+				glm::vec3 bin_min[bins], bin_max[bins];
+				for (GLuint b = 0; b < bins; ++b)
+				{
+					bin_min[b] = glm::vec3(FLT_MAX);
+					bin_max[b] = glm::vec3(-FLT_MAX);
+				}
+
+				float scale = bins / extent;
+				for (GLuint i = first; i < first + size; ++i)
+				{
+					const bounding_box& box = _boxes[_objects[i]];
+					GLuint b = std::min(bins - 1, static_cast<GLuint>((_centers[_objects[i]][axis] - centroid_min[axis]) * scale));
+					++bin_count[b];
+					grow(bin_min[b], bin_max[b], box);
+				}
+
+				// sweep from the right to get the area and count right of every split
+				float right_area[bins] = {};
+				GLuint right_count[bins] = {};
+				glm::vec3 sweep_min(FLT_MAX), sweep_max(-FLT_MAX);
+				GLuint sweep_count = 0;
+				for (GLuint b = bins - 1; b > 0; --b)
+				{
+					sweep_min = glm::min(sweep_min, bin_min[b]);
+					sweep_max = glm::max(sweep_max, bin_max[b]);
+					sweep_count += bin_count[b];
+					right_area[b] = area(sweep_min, sweep_max);
+					right_count[b] = sweep_count;
+				}
+
+				sweep_min = glm::vec3(FLT_MAX);
+				sweep_max = glm::vec3(-FLT_MAX);
+				sweep_count = 0;
+				for (GLuint b = 1; b < bins; ++b)
+				{
+					sweep_min = glm::min(sweep_min, bin_min[b - 1]);
+					sweep_max = glm::max(sweep_max, bin_max[b - 1]);
+					sweep_count += bin_count[b - 1];
+
+					if (0 == sweep_count || 0 == right_count[b])
+					{
+						continue;
+					}
+
+					float cost = sweep_count * area(sweep_min, sweep_max) + right_count[b] * right_area[b];
+					if (cost < best_cost)
+					{
+						best_cost = cost;
+						best_axis = axis;
+						best_bin = b;
+					}
+				}
+			}
+
+			if (best_axis < 0)
+			{
+				// every centroid in one point, halve by count so huge piles of equal boxes still split
+				return size > 4 * leaf_size ? first + size / 2 : first;
+			}
+
+			// a leaf costs one test per object, splitting pays off when the children are cheaper
+			if (size <= 4 * leaf_size && best_cost >= size * area(min, max))
+			{
+				return first;
+			}
+
+			float scale = bins / (centroid_max[best_axis] - centroid_min[best_axis]);
+			float origin = centroid_min[best_axis];
+			std::vector<GLuint>::iterator middle = std::partition(_objects.begin() + first, _objects.begin() + first + size, [this, best_axis, best_bin, scale, origin](GLuint id) {
+				return std::min(bins - 1, static_cast<GLuint>((_centers[id][best_axis] - origin) * scale)) < best_bin;
+			});
+
+			return static_cast<GLuint>(middle - _objects.begin());
+		}
+
+		void build_node(GLuint first, GLuint size)
+		{
+			GLuint index = static_cast<GLuint>(_nodes.size());
+			_nodes.push_back(node());
+
+			glm::vec3 min(FLT_MAX), max(-FLT_MAX);
+			for (GLuint i = first; i < first + size; ++i)
+			{
+				grow(min, max, _boxes[_objects[i]]);
+			}
+
+			_nodes[index].min = min;
+			_nodes[index].max = max;
+			_nodes[index].first = first;
+
+			GLuint middle = size > leaf_size ? split(first, size, min, max) : first;
+			if (middle > first && middle < first + size)
+			{
+				build_node(first, middle - first);
+				build_node(middle, first + size - middle);
+			}
+
+			_nodes[index].skip = static_cast<GLuint>(_nodes.size());
+		}
+
+		void accept(GLuint index, std::vector<GLuint>& ids) const
+		{
+			GLuint first = _nodes[index].first;
+			ids.insert(ids.end(), _objects.begin() + first, _objects.begin() + first + count(index));
+		}
+
+	public:
+		bvh()
+		{
+		}
+
+		// object ids are the indices into boxes
+		void build(const bounding_box* boxes, GLuint count)
+		{
+			_boxes.assign(boxes, boxes + count);
+
+			_objects.resize(count);
+			_centers.resize(count);
+			for (GLuint i = 0; i < count; ++i)
+			{
+				_objects[i] = i;
+				_centers[i] = boxes[i].center();
+			}
+
+			_nodes.clear();
+			_nodes.reserve(count > 0 ? 2 * count : 0);
+			if (count > 0)
+			{
+				build_node(0, count);
+			}
+
+			std::vector<glm::vec3>().swap(_centers);
+		}
+
+		// move an object, the tree is only correct again after refit()
+		void update(GLuint id, const bounding_box& box)
+		{
+			_boxes[id] = box;
+		}
+
+		// recompute every node box from the object boxes, children come after their parent so one backwards pass does it
+		void refit()
+		{
+			for (GLuint index = static_cast<GLuint>(_nodes.size()); index-- > 0; )
+			{
+				node& n = _nodes[index];
+				if (leaf(index))
+				{
+					n.min = glm::vec3(FLT_MAX);
+					n.max = glm::vec3(-FLT_MAX);
+					for (GLuint i = n.first; i < n.first + count(index); ++i)
+					{
+						grow(n.min, n.max, _boxes[_objects[i]]);
+					}
+				}
+				else
+				{
+					const node& left = _nodes[index + 1];
+					const node& right = _nodes[left.skip];
+					n.min = glm::min(left.min, right.min);
+					n.max = glm::max(left.max, right.max);
+				}
+			}
+		}
+
+		// ids of the objects whose box intersects the frustum, conservative like frustum::intersects
+		void query(const frustum& view, std::vector<GLuint>& ids) const
+		{
+			if (_nodes.empty())
+			{
+				return;
+			}
+
+			// one bit per plane the subtree still has to be tested against
+			std::vector<std::pair<GLuint, GLuint>> stack;
+			stack.reserve(64);
+			stack.push_back(std::make_pair(0u, 0x3Fu));
+
+			while (!stack.empty())
+			{
+				GLuint index = stack.back().first;
+				GLuint mask = stack.back().second;
+				stack.pop_back();
+
+				const node& n = _nodes[index];
+
+				bool outside = false;
+				for (int plane = 0; plane < 6 && !outside; ++plane)
+				{
+					if (0 == (mask & (1u << plane)))
+					{
+						continue;
+					}
+
+					glm::vec3 normal(view.planes[plane]);
+					glm::vec3 far_corner(normal.x > 0.0f ? n.max.x : n.min.x, normal.y > 0.0f ? n.max.y : n.min.y, normal.z > 0.0f ? n.max.z : n.min.z);
+					glm::vec3 near_corner(normal.x > 0.0f ? n.min.x : n.max.x, normal.y > 0.0f ? n.min.y : n.max.y, normal.z > 0.0f ? n.min.z : n.max.z);
+
+					if (glm::dot(normal, far_corner) + view.planes[plane].w < 0.0f)
+					{
+						outside = true;
+					}
+					else if (glm::dot(normal, near_corner) + view.planes[plane].w >= 0.0f)
+					{
+						mask &= ~(1u << plane);
+					}
+				}
+
+				if (outside)
+				{
+					continue;
+				}
+
+				if (0 == mask || leaf(index))
+				{
+					// a leaf that passed the node box is tested per object, a fully inside subtree is taken whole
+					if (0 == mask)
+					{
+						accept(index, ids);
+					}
+					else
+					{
+						for (GLuint i = n.first; i < n.first + count(index); ++i)
+						{
+							if (view.intersects(_boxes[_objects[i]]))
+							{
+								ids.push_back(_objects[i]);
+							}
+						}
+					}
+					continue;
+				}
+
+				stack.push_back(std::make_pair(_nodes[index + 1].skip, mask));
+				stack.push_back(std::make_pair(index + 1, mask));
+			}
+		}
+
+		// what the camera sees
+		void query(const camera& eye, std::vector<GLuint>& ids) const
+		{
+			query(eye.view_frustum(), ids);
+		}
+
+		// ids of the objects whose box intersects the sphere
+		void query(const bounding_sphere& sphere, std::vector<GLuint>& ids) const
+		{
+			if (_nodes.empty())
+			{
+				return;
+			}
+
+			float radius2 = sphere.radius * sphere.radius;
+
+			std::vector<GLuint> stack;
+			stack.reserve(64);
+			stack.push_back(0);
+
+			while (!stack.empty())
+			{
+				GLuint index = stack.back();
+				stack.pop_back();
+
+				const node& n = _nodes[index];
+
+				glm::vec3 nearest = glm::clamp(sphere.center, n.min, n.max);
+				if (glm::dot(nearest - sphere.center, nearest - sphere.center) > radius2)
+				{
+					continue;
+				}
+
+				glm::vec3 farthest = glm::max(glm::abs(n.min - sphere.center), glm::abs(n.max - sphere.center));
+				if (glm::dot(farthest, farthest) <= radius2)
+				{
+					accept(index, ids);
+					continue;
+				}
+
+				if (leaf(index))
+				{
+					for (GLuint i = n.first; i < n.first + count(index); ++i)
+					{
+						const bounding_box& box = _boxes[_objects[i]];
+						glm::vec3 p = glm::clamp(sphere.center, box.min, box.max);
+						if (glm::dot(p - sphere.center, p - sphere.center) <= radius2)
+						{
+							ids.push_back(_objects[i]);
+						}
+					}
+					continue;
+				}
+
+				stack.push_back(_nodes[index + 1].skip);
+				stack.push_back(index + 1);
+			}
+		}
+
+		/*
+		*
+		* Nearest object box hit by the ray within max_distance, e.g. from camera::position() along camera::front()
+		* for picking. Children are visited near first, so most far subtrees are pruned by the current hit.
+		*
+		*/
+		bool raycast(const glm::vec3& origin, const glm::vec3& direction, float max_distance, GLuint& id, float& distance) const
+		{
+			if (_nodes.empty())
+			{
+				return false;
+			}
+
+			glm::vec3 inverse(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+			// entry distance t of the ray into a box, false when missed or beyond limit. An axis the ray is parallel
+			// to only checks the origin is within the slab, 0 * inf would be nan there
+			auto enter = [&origin, &direction, &inverse](const glm::vec3& min, const glm::vec3& max, float limit, float& t) {
+				float t_enter = 0.0f, t_exit = limit;
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					if (0.0f == direction[axis])
+					{
+						if (origin[axis] < min[axis] || origin[axis] > max[axis])
+						{
+							return false;
+						}
+						continue;
+					}
+
+					float t0 = (min[axis] - origin[axis]) * inverse[axis];
+					float t1 = (max[axis] - origin[axis]) * inverse[axis];
+					t_enter = std::max(t_enter, std::min(t0, t1));
+					t_exit = std::min(t_exit, std::max(t0, t1));
+				}
+
+				t = t_enter;
+				return t_enter <= t_exit;
+			};
+
+			bool res = false;
+			float best = max_distance;
+
+			std::vector<GLuint> stack;
+			stack.reserve(64);
+			stack.push_back(0);
+
+			while (!stack.empty())
+			{
+				GLuint index = stack.back();
+				stack.pop_back();
+
+				const node& n = _nodes[index];
+				float t = 0.0f;
+				if (!enter(n.min, n.max, best, t))
+				{
+					continue;
+				}
+
+				if (leaf(index))
+				{
+					for (GLuint i = n.first; i < n.first + count(index); ++i)
+					{
+						// the first hit may lie at max_distance, later ones have to be strictly nearer
+						const bounding_box& box = _boxes[_objects[i]];
+						if (enter(box.min, box.max, best, t) && (!res || t < best))
+						{
+							best = t;
+							id = _objects[i];
+							res = true;
+						}
+					}
+					continue;
+				}
+
+				GLuint left = index + 1, right = _nodes[index + 1].skip;
+				float t_left = 0.0f, t_right = 0.0f;
+				bool hit_left = enter(_nodes[left].min, _nodes[left].max, best, t_left);
+				bool hit_right = enter(_nodes[right].min, _nodes[right].max, best, t_right);
+
+				// push the far child first so the near one is popped next
+				bool left_first = hit_left && (!hit_right || t_left <= t_right);
+				if (hit_left && hit_right)
+				{
+					stack.push_back(left_first ? right : left);
+					stack.push_back(left_first ? left : right);
+				}
+				else if (hit_left || hit_right)
+				{
+					stack.push_back(hit_left ? left : right);
+				}
+			}
+
+			if (res)
+			{
+				distance = best;
+			}
+			return res;
+		}
+
+		GLuint object_count() const
+		{
+			return static_cast<GLuint>(_boxes.size());
+		}
+
+		GLuint node_count() const
+		{
+			return static_cast<GLuint>(_nodes.size());
+		}
+
+		const bounding_box& box(GLuint id) const
+		{
+			return _boxes[id];
+		}
+
+		~bvh()
+		{
+		}
+
+	private:
+		bvh(const bvh&) = delete;
+		bvh& operator=(const bvh&) = delete;
+		bvh(bvh&&) = delete;
+		bvh&& operator=(bvh&&) = delete;
+	};
+};
+
+#endif
@@ -1,177 +1,456 @@
-
-#ifndef _GLIMPLIFY_CAMERA_H_
-#define _GLIMPLIFY_CAMERA_H_
-
-#include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
-
-namespace glimplify {
-
-	/*
-	* 
-	* The camera system we introduced is a fly like camera that suits most purposes and works well with Euler angles, 
-	* but be careful when creating different camera systems like an FPS camera, or a flight simulation camera. 
-	* Each camera system has its own tricks and quirks so be sure to read up on them. 
-	* For example, this fly camera doesn't allow for pitch values higher than or equal to 90 degrees and 
-	* a static up vector of (0,1,0) doesn't work when we take roll values into account.
-	* 
-	*/
-
-	class camera
-	{
-		float _width;
-		float _height;
-
-		glm::vec3 _position;
-		glm::vec3 _front;
-		glm::vec3 _up;
-
-		glm::mat4 _view;
-
-		float _move_sensitive;
-
-		float _pitch;
-		float _yaw;
-		float _rotate_sensitive;
-
-		float _fov;
-		float _nearest;
-		float _farest;
-		glm::mat4 _perspective;
-
-	public:
-		explicit camera(int width, int height)
-			: _width(width), _height(height)
-			, _position(), _front(0.0f, 0.0f, -1.0f), _up(0.0f, 1.0f, 0.0f)
-			, _view(glm::lookAt(_position, _position + _front, _up))
-			, _move_sensitive(2.5f)
-			// yaw is initialized to -90.0 degrees since a yaw of 0.0 results in a direction vector pointing to the right so we initially rotate a bit to the left.
-			, _pitch(0.0f), _yaw(-90.0f), _rotate_sensitive(0.1f)
-			, _fov(45.0f), _nearest(0.1f), _farest(100.0f)
-			, _perspective(glm::perspective(glm::radians(_fov), _width / _height, _nearest, _farest))
-		{
-		}
-
-		void move_to(const glm::vec3& position)
-		{
-			_position = position;
-			_view = glm::lookAt(_position, _position + _front, _up);
-		}
-
-		void perspective(float fov, float nearest, float farest)
-		{
-			_fov = fov;
-			if (_fov < 1.0f)
-			{
-				_fov = 1.0f;
-			}
-			else if (_fov > 45.0f)
-			{
-				_fov = 45.0f;
-			}
-
-			_nearest = nearest;
-			_farest = farest;
-
-			_perspective = glm::perspective(glm::radians(_fov), _width / _height, _nearest, _farest);
-		}
-
-		void zoom(float fov_offset)
-		{
-			_fov += fov_offset;
-
-			if (_fov < 1.0f)
-			{
-				_fov = 1.0f;
-			}
-			else if (_fov > 45.0f)
-			{
-				_fov = 45.0f;
-			}
-
-			_perspective = glm::perspective(glm::radians(_fov), _width / _height, _nearest, _farest);
-		}
-
-		const glm::mat4 forward(float delta_time)
-		{
-			_position += _move_sensitive * delta_time * _front;
-			_view = glm::lookAt(_position, _position + _front, _up);
-			return _view;
-		}
-		
-		const glm::mat4 backward(float delta_time)
-		{
-			_position -= _move_sensitive * delta_time * _front;
-			_view = glm::lookAt(_position, _position + _front, _up);
-			return _view;
-		}
-
-		const glm::mat4 rotate(float pitch_offset, float yaw_offset)
-		{
-			_pitch += pitch_offset;
-			// make sure that when pitch is out of bounds, screen doesn't get flipped
-			if (_pitch > 89.0f)
-			{
-				_pitch = 89.0f;
-			}
-			else if (_pitch < -89.0f)
-			{
-				_pitch = -89.0f;
-			}
-
-			_yaw += yaw_offset;
-
-			_front = glm::normalize(glm::vec3(cos(glm::radians(_yaw)) * cos(glm::radians(_pitch)), sin(glm::radians(_pitch)), sin(glm::radians(_yaw)) * cos(glm::radians(_pitch))));
-			
-			_view = glm::lookAt(_position, _position + _front, _up);
-			
-			return _view;
-		}
-
-		const glm::mat4 left(float delta_time)
-		{
-			glm::vec3 offset = glm::normalize(glm::cross(_front, _up)) * _move_sensitive * delta_time;
-
-			_position -= offset;
-
-			_view = glm::lookAt(_position, _position + _front, _up);
-
-			return _view;
-		}
-
-		const glm::mat4 right(float delta_time)
-		{
-			glm::vec3 offset = glm::normalize(glm::cross(_front, _up)) * _move_sensitive * delta_time;
-
-			_position += offset;
-
-			_view = glm::lookAt(_position, _position + _front, _up);
-
-			return _view;
-		}
-
-		const glm::mat4 view_matrix()
-		{
-			return _view;
-		}
-
-		const glm::mat4 perspective_matrix()
-		{
-			return _perspective;
-		}
-
-		~camera()
-		{
-		}
-
-	private:
-		camera() = delete;
-		camera(const camera&) = delete;
-		camera& operator=(const camera&) = delete;
-		camera(camera&&) = delete;
-		camera&& operator=(camera&&) = delete;
-	};
-};
-
-#endif
+
+#ifndef _GLIMPLIFY_CAMERA_H_
+#define _GLIMPLIFY_CAMERA_H_
+
+#include "bounds.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cmath>
+
+namespace glimplify {
+
+	/*
+	* 
+	* The camera system we introduced is a fly like camera that suits most purposes and works well with Euler angles, 
+	* but be careful when creating different camera systems like an FPS camera, or a flight simulation camera. 
+	* Each camera system has its own tricks and quirks so be sure to read up on them. 
+	* For example, this fly camera doesn't allow for pitch values higher than or equal to 90 degrees and 
+	* a static up vector of (0,1,0) doesn't work when we take roll values into account.
+	* 
+	* The free mode is for that: the orientation is a quaternion turned by small rotations about the camera's own axes,
+	* so there are no clamps, roll works and nothing degenerates looking straight up. Both modes cache the right,
+	* up and front vectors and write the view matrix from them directly, there is no lookAt per update.
+	*
+	*     camera.mode(glimplify::camera::orientation::free);
+	*     camera.rotate(pitch_offset, yaw_offset);     // degrees, about the current right and up axes
+	*     camera.roll(roll_offset);
+	*     camera.up(delta_time);                       // 6 degrees of freedom, along the camera up
+	*
+	*/
+
+	class camera
+	{
+	public:
+		enum class orientation
+		{
+			// yaw and pitch with a fixed world up, pitch stays within +-89 degrees
+			euler,
+			// incremental quaternion rotation, roll allowed
+			free
+		};
+
+	private:
+		float _width;
+		float _height;
+
+		orientation _mode;
+
+		glm::vec3 _position;
+		glm::vec3 _front;
+		// the camera up, in euler mode derived from the world up
+		glm::vec3 _up;
+		glm::vec3 _right;
+
+		// camera to world rotation, only kept in free mode
+		glm::quat _orientation;
+
+		glm::mat4 _view;
+
+		float _move_sensitive;
+
+		float _pitch;
+		float _yaw;
+		float _rotate_sensitive;
+
+		float _fov;
+		float _nearest;
+		float _farest;
+		depth_convention _depth;
+		glm::mat4 _perspective;
+
+	public:
+		explicit camera(int width, int height)
+			: _width(width), _height(height)
+			, _mode(orientation::euler)
+			, _position(), _front(0.0f, 0.0f, -1.0f), _up(0.0f, 1.0f, 0.0f), _right(1.0f, 0.0f, 0.0f)
+			, _orientation()
+			, _view(1.0f)
+			, _move_sensitive(2.5f)
+			// yaw is initialized to -90.0 degrees since a yaw of 0.0 results in a direction vector pointing to the right so we initially rotate a bit to the left.
+			, _pitch(0.0f), _yaw(-90.0f), _rotate_sensitive(0.1f)
+			, _fov(45.0f), _nearest(0.1f), _farest(100.0f), _depth(depth_convention::standard)
+			, _perspective(1.0f)
+		{
+			update_view();
+			update_perspective();
+		}
+
+		void move_to(const glm::vec3& position)
+		{
+			_position = position;
+			update_view();
+		}
+
+		/*
+		*
+		* The reverse convention projects with an infinite far plane and near at depth 1, farest is ignored.
+		* Floats are densest around 0, which is where the distance now goes, so precision stays roughly
+		* constant with distance instead of collapsing behind the near plane. It needs context::reverse_depth().
+		*
+		*/
+		void depth(depth_convention convention)
+		{
+			_depth = convention;
+			update_perspective();
+		}
+
+		depth_convention depth() const
+		{
+			return _depth;
+		}
+
+		// switching to euler drops the roll and clamps the pitch
+		void mode(orientation m)
+		{
+			if (m == _mode)
+			{
+				return;
+			}
+
+			_mode = m;
+			if (orientation::free == _mode)
+			{
+				_orientation = glm::normalize(glm::quat_cast(glm::mat3(_right, _up, -_front)));
+			}
+			else
+			{
+				_pitch = glm::clamp(glm::degrees(std::asin(glm::clamp(_front.y, -1.0f, 1.0f))), -89.0f, 89.0f);
+				_yaw = glm::degrees(std::atan2(_front.z, _front.x));
+				euler_basis();
+			}
+
+			update_view();
+		}
+
+		orientation mode() const
+		{
+			return _mode;
+		}
+
+		void perspective(float fov, float nearest, float farest)
+		{
+			_fov = fov;
+			if (_fov < 1.0f)
+			{
+				_fov = 1.0f;
+			}
+			else if (_fov > 45.0f)
+			{
+				_fov = 45.0f;
+			}
+
+			_nearest = nearest;
+			_farest = farest;
+
+			update_perspective();
+		}
+
+		void zoom(float fov_offset)
+		{
+			_fov += fov_offset;
+
+			if (_fov < 1.0f)
+			{
+				_fov = 1.0f;
+			}
+			else if (_fov > 45.0f)
+			{
+				_fov = 45.0f;
+			}
+
+			update_perspective();
+		}
+
+		const glm::mat4 forward(float delta_time)
+		{
+			_position += _move_sensitive * delta_time * _front;
+			update_view();
+			return _view;
+		}
+		
+		const glm::mat4 backward(float delta_time)
+		{
+			_position -= _move_sensitive * delta_time * _front;
+			update_view();
+			return _view;
+		}
+
+		const glm::mat4 rotate(float pitch_offset, float yaw_offset)
+		{
+			turn(pitch_offset, yaw_offset, 0.0f);
+			update_view();
+
+			return _view;
+		}
+
+		// degrees about the view direction, clockwise as seen by the camera, free mode only
+		const glm::mat4 roll(float roll_offset)
+		{
+			turn(0.0f, 0.0f, roll_offset);
+			update_view();
+
+			return _view;
+		}
+
+		/*
+		*
+		* All the input of a frame or a step at once, with one basis and view update: move is scaled by the move
+		* sensitivity and goes along the current right, up and front, then the camera turns by the offsets in
+		* degrees, rolling in free mode only.
+		*
+		*/
+		const glm::mat4 transform(const glm::vec3& move, float pitch_offset, float yaw_offset, float roll_offset = 0.0f)
+		{
+			_position += _move_sensitive * (move.x * _right + move.y * _up + move.z * _front);
+
+			if (0.0f != pitch_offset || 0.0f != yaw_offset || 0.0f != roll_offset)
+			{
+				turn(pitch_offset, yaw_offset, roll_offset);
+			}
+			update_view();
+
+			return _view;
+		}
+
+		// set the whole free mode orientation, camera to world, the camera looks along -z with +y up
+		void orient(const glm::quat& rotation)
+		{
+			mode(orientation::free);
+
+			_orientation = glm::normalize(rotation);
+			free_basis();
+			update_view();
+		}
+
+		const glm::mat4 left(float delta_time)
+		{
+			_position -= _move_sensitive * delta_time * _right;
+			update_view();
+			return _view;
+		}
+
+		const glm::mat4 right(float delta_time)
+		{
+			_position += _move_sensitive * delta_time * _right;
+			update_view();
+			return _view;
+		}
+
+		const glm::mat4 up(float delta_time)
+		{
+			_position += _move_sensitive * delta_time * _up;
+			update_view();
+			return _view;
+		}
+
+		const glm::mat4 down(float delta_time)
+		{
+			_position -= _move_sensitive * delta_time * _up;
+			update_view();
+			return _view;
+		}
+
+		const glm::mat4 view_matrix()
+		{
+			return _view;
+		}
+
+		// camera to world rotation in either mode
+		glm::quat rotation() const
+		{
+			return glm::normalize(glm::quat_cast(glm::mat3(_right, _up, -_front)));
+		}
+
+		/*
+		*
+		* The view of a pose between an earlier one, e.g. before the last fixed simulation step, and the current one.
+		* Passing the current rotation as from_rotation interpolates the position only, mouse look stays immediate.
+		*
+		*/
+		glm::mat4 interpolated_view(const glm::vec3& from_position, const glm::quat& from_rotation, float alpha) const
+		{
+			glm::vec3 position = glm::mix(from_position, _position, alpha);
+			glm::mat3 basis = glm::mat3_cast(glm::normalize(glm::slerp(from_rotation, rotation(), alpha)));
+
+			glm::mat4 res(1.0f);
+			for (int i = 0; i < 3; ++i)
+			{
+				res[0][i] = basis[i].x; res[1][i] = basis[i].y; res[2][i] = basis[i].z;
+				res[3][i] = -glm::dot(basis[i], position);
+			}
+
+			return res;
+		}
+
+		const glm::mat4 perspective_matrix()
+		{
+			return _perspective;
+		}
+
+		// viewport size in pixels
+		float width() const
+		{
+			return _width;
+		}
+
+		float height() const
+		{
+			return _height;
+		}
+
+		// vertical field of view in degrees
+		float fov() const
+		{
+			return _fov;
+		}
+
+		float nearest() const
+		{
+			return _nearest;
+		}
+
+		// the far plane of the standard projection, the reverse one has none
+		float farest() const
+		{
+			return _farest;
+		}
+
+		const glm::vec3& position() const
+		{
+			return _position;
+		}
+
+		// unit view direction
+		const glm::vec3& front() const
+		{
+			return _front;
+		}
+
+		// unit camera up and right, they include the roll in free mode
+		const glm::vec3& up_vector() const
+		{
+			return _up;
+		}
+
+		const glm::vec3& right_vector() const
+		{
+			return _right;
+		}
+
+		// world space planes of what the camera sees, for culling
+		frustum view_frustum() const
+		{
+			return frustum::from_matrix(_perspective * _view, _depth);
+		}
+
+		~camera()
+		{
+		}
+
+	private:
+		void update_perspective()
+		{
+			if (depth_convention::standard == _depth)
+			{
+				_perspective = glm::perspective(glm::radians(_fov), _width / _height, _nearest, _farest);
+				return;
+			}
+
+			// clip z is the constant near and clip w the view distance, so ndc z = near / distance
+			float focal = 1.0f / std::tan(glm::radians(_fov) * 0.5f);
+
+			_perspective = glm::mat4(0.0f);
+			_perspective[0][0] = focal * _height / _width;
+			_perspective[1][1] = focal;
+			_perspective[2][3] = -1.0f;
+			_perspective[3][2] = _nearest;
+		}
+
+		// the orientation and the basis, not the view
+		void turn(float pitch_offset, float yaw_offset, float roll_offset)
+		{
+			if (orientation::free == _mode)
+			{
+				// yaw about the camera up, then pitch about the camera right, a positive yaw turns right like in euler mode
+				_orientation = _orientation * glm::angleAxis(glm::radians(-yaw_offset), glm::vec3(0.0f, 1.0f, 0.0f)) * glm::angleAxis(glm::radians(pitch_offset), glm::vec3(1.0f, 0.0f, 0.0f));
+				if (0.0f != roll_offset)
+				{
+					_orientation = _orientation * glm::angleAxis(glm::radians(roll_offset), glm::vec3(0.0f, 0.0f, -1.0f));
+				}
+				_orientation = glm::normalize(_orientation);
+				free_basis();
+				return;
+			}
+
+			_pitch += pitch_offset;
+			// make sure that when pitch is out of bounds, screen doesn't get flipped
+			if (_pitch > 89.0f)
+			{
+				_pitch = 89.0f;
+			}
+			else if (_pitch < -89.0f)
+			{
+				_pitch = -89.0f;
+			}
+
+			_yaw += yaw_offset;
+
+			euler_basis();
+		}
+
+		void euler_basis()
+		{
+			float yaw = glm::radians(_yaw), pitch = glm::radians(_pitch);
+			float cos_pitch = std::cos(pitch);
+
+			_front = glm::vec3(std::cos(yaw) * cos_pitch, std::sin(pitch), std::sin(yaw) * cos_pitch);
+			_right = glm::normalize(glm::cross(_front, glm::vec3(0.0f, 1.0f, 0.0f)));
+			_up = glm::cross(_right, _front);
+		}
+
+		void free_basis()
+		{
+			glm::mat3 rotation = glm::mat3_cast(_orientation);
+
+			_right = rotation[0];
+			_up = rotation[1];
+			_front = -rotation[2];
+		}
+
+		// the inverse of the camera to world transform, what lookAt computes, from the cached orthonormal basis
+		void update_view()
+		{
+			_view[0][0] = _right.x; _view[1][0] = _right.y; _view[2][0] = _right.z;
+			_view[0][1] = _up.x; _view[1][1] = _up.y; _view[2][1] = _up.z;
+			_view[0][2] = -_front.x; _view[1][2] = -_front.y; _view[2][2] = -_front.z;
+			_view[0][3] = 0.0f; _view[1][3] = 0.0f; _view[2][3] = 0.0f;
+
+			_view[3][0] = -glm::dot(_right, _position);
+			_view[3][1] = -glm::dot(_up, _position);
+			_view[3][2] = glm::dot(_front, _position);
+			_view[3][3] = 1.0f;
+		}
+
+		camera() = delete;
+		camera(const camera&) = delete;
+		camera& operator=(const camera&) = delete;
+		camera(camera&&) = delete;
+		camera&& operator=(camera&&) = delete;
+	};
+};
+
+#endif
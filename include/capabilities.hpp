@@ -0,0 +1,186 @@
+
+#ifndef _GLIMPLIFY_CAPABILITIES_H_
+#define _GLIMPLIFY_CAPABILITIES_H_
+
+#include <glad/glad.h>
+
+#include <string>
+#include <unordered_set>
+
+namespace glimplify {
+
+	/*
+	*
+	* What the current context supports, queried once on first use, so it must not be touched before glad is loaded.
+	* Wrapper classes pick their code path from here when they are created.
+	*
+	*/
+
+	class capabilities
+	{
+		GLint _major;
+		GLint _minor;
+
+		std::unordered_set<std::string> _extensions;
+
+		bool _direct_state_access;
+		bool _vertex_attrib_binding;
+		bool _program_uniform;
+		bool _parallel_shader_compile;
+		bool _program_interface_query;
+		bool _separate_shader_objects;
+		bool _compute_shader;
+		bool _indirect_parameters;
+		bool _clip_control;
+		bool _invalidate_subdata;
+		bool _texture_storage;
+		bool _texture_storage_multisample;
+
+	public:
+		static capabilities& current()
+		{
+			static capabilities caps;
+			return caps;
+		}
+
+		bool version(GLint major, GLint minor) const
+		{
+			return _major > major || (_major == major && _minor >= minor);
+		}
+
+		bool extension(const char* name) const
+		{
+			return _extensions.end() != _extensions.find(name);
+		}
+
+		// glCreate*, glNamed*, glVertexArray*, glTexture*
+		bool direct_state_access() const
+		{
+			return _direct_state_access;
+		}
+
+		// glVertexAttribFormat/glBindVertexBuffer, vertex formats separate from the buffers they read
+		bool vertex_attrib_binding() const
+		{
+			return _vertex_attrib_binding;
+		}
+
+		// glProgramUniform*, uniforms can be set without binding the program
+		bool program_uniform() const
+		{
+			return _program_uniform;
+		}
+
+		// shaders compile on driver threads and GL_COMPLETION_STATUS_KHR can be polled
+		bool parallel_shader_compile() const
+		{
+			return _parallel_shader_compile;
+		}
+
+		// glGetProgramInterfaceiv/glGetProgramResource*, every active resource of a program in one kind of query
+		bool program_interface_query() const
+		{
+			return _program_interface_query;
+		}
+
+		// GL_PROGRAM_SEPARABLE and program pipeline objects
+		bool separate_shader_objects() const
+		{
+			return _separate_shader_objects;
+		}
+
+		// compute programs, shader storage buffers and glMultiDrawElementsIndirect
+		bool compute_shader() const
+		{
+			return _compute_shader;
+		}
+
+		// glMultiDrawElementsIndirectCount, the draw count is read from a gpu buffer
+		bool indirect_parameters() const
+		{
+			return _indirect_parameters;
+		}
+
+		// glClipControl, needed for a reverse depth buffer that gains precision
+		bool clip_control() const
+		{
+			return _clip_control;
+		}
+
+		// glInvalidateFramebuffer, attachment contents a pass no longer needs are not written back
+		bool invalidate_subdata() const
+		{
+			return _invalidate_subdata;
+		}
+
+		// glTexStorage2D/3D, immutable textures, otherwise every level is allocated with glTexImage*
+		bool texture_storage() const
+		{
+			return _texture_storage;
+		}
+
+		// glTexStorage2DMultisample, otherwise glTexImage2DMultisample
+		bool texture_storage_multisample() const
+		{
+			return _texture_storage_multisample;
+		}
+
+		// force the bind-to-edit path, objects created afterwards use it, mostly useful to test the fallback
+		void disable_direct_state_access()
+		{
+			_direct_state_access = false;
+			_program_uniform = false;
+		}
+
+		~capabilities()
+		{
+		}
+
+	private:
+		capabilities()
+			: _major(0), _minor(0)
+			, _direct_state_access(false), _vertex_attrib_binding(false), _program_uniform(false), _parallel_shader_compile(false), _program_interface_query(false)
+			, _separate_shader_objects(false), _compute_shader(false), _indirect_parameters(false), _clip_control(false), _invalidate_subdata(false)
+			, _texture_storage(false), _texture_storage_multisample(false)
+		{
+			glGetIntegerv(GL_MAJOR_VERSION, &_major);
+			glGetIntegerv(GL_MINOR_VERSION, &_minor);
+
+			GLint count = 0;
+			glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+			for (GLint i = 0; i < count; ++i)
+			{
+				const GLubyte* name = glGetStringi(GL_EXTENSIONS, i);
+				if (name)
+				{
+					_extensions.insert(reinterpret_cast<const char*>(name));
+				}
+			}
+
+			_direct_state_access = version(4, 5) || extension("GL_ARB_direct_state_access");
+			_vertex_attrib_binding = version(4, 3) || extension("GL_ARB_vertex_attrib_binding");
+			_program_uniform = version(4, 1) || extension("GL_ARB_separate_shader_objects");
+			_parallel_shader_compile = extension("GL_KHR_parallel_shader_compile") || extension("GL_ARB_parallel_shader_compile");
+			_separate_shader_objects = version(4, 1) || extension("GL_ARB_separate_shader_objects");
+			_compute_shader = version(4, 3) || extension("GL_ARB_compute_shader");
+#if defined(GL_ARB_indirect_parameters)
+			_indirect_parameters = version(4, 6) || extension("GL_ARB_indirect_parameters");
+#else
+			// without the ARB entry points loaded only the 4.6 core ones can be called
+			_indirect_parameters = version(4, 6);
+#endif
+			_program_interface_query = version(4, 3) || extension("GL_ARB_program_interface_query");
+			_clip_control = version(4, 5) || extension("GL_ARB_clip_control");
+			_invalidate_subdata = version(4, 3) || extension("GL_ARB_invalidate_subdata");
+			_texture_storage = version(4, 2) || extension("GL_ARB_texture_storage");
+			_texture_storage_multisample = version(4, 3) || extension("GL_ARB_texture_storage_multisample");
+		}
+
+		capabilities(const capabilities&) = delete;
+		capabilities& operator=(const capabilities&) = delete;
+		capabilities(capabilities&&) = delete;
+		capabilities&& operator=(capabilities&&) = delete;
+	};
+};
+
+#endif
@@ -1,59 +1,341 @@
-
-#ifndef _GLIMPLIFY_CONTEXT_H_
-#define _GLIMPLIFY_CONTEXT_H_
-
-#include <glad/glad.h>
-
-namespace glimplify {
-
-	class context
-	{
-		GLbitfield _clear_bitfield;
-
-	public:
-		explicit context(GLDEBUGPROC callback, const void* user_data = nullptr)
-			: _clear_bitfield(GL_COLOR_BUFFER_BIT)
-		{
-			glEnable(GL_DEBUG_OUTPUT);
-			glDebugMessageCallback(callback, user_data);
-		}
-
-		void wireframe_mode()
-		{
-			glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-		}
-
-		void testing_depth(bool testing = true)
-		{
-			if (testing)
-			{
-				_clear_bitfield = _clear_bitfield | GL_DEPTH_BUFFER_BIT;
-				glEnable(GL_DEPTH_TEST);
-			}
-			else
-			{
-				_clear_bitfield = _clear_bitfield & (GL_DEPTH_BUFFER_BIT ^ 0xFFFFFFFF);
-				glDisable(GL_DEPTH_TEST);
-			}
-		}
-
-		void clear(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
-		{
-			glClearColor(red, green, blue, alpha);
-			glClear(_clear_bitfield);
-		}
-
-		~context()
-		{
-		}
-
-	private:
-		context() = delete;
-		context(const context&) = delete;
-		context& operator=(const context&) = delete;
-		context(context&&) = delete;
-		context&& operator=(context&&) = delete;
-	};
-};
-
-#endif
+
+#ifndef _GLIMPLIFY_CONTEXT_H_
+#define _GLIMPLIFY_CONTEXT_H_
+
+#include "bounds.hpp"
+#include "capabilities.hpp"
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <cstdint>
+
+namespace glimplify {
+
+	/*
+	*
+	* Reverse depth: near at 1, far at 0, GL_GREATER, cleared to 0, with camera::depth(depth_convention::reverse).
+	* It only pays off with a float depth buffer, the window's is fixed point, so float_depth() moves rendering
+	* into an offscreen color + GL_DEPTH_COMPONENT32F target that present() copies to the window:
+	*
+	*     if (context.reverse_depth())
+	*     {
+	*         camera.depth(glimplify::depth_convention::reverse);
+	*         context.float_depth(width, height);     // again on every resize
+	*     }
+	*     ...
+	*     context.present();
+	*     glfwSwapBuffers(window);
+	*
+	* Frames in flight: the driver otherwise queues as many frames as it likes, which adds input latency and
+	* makes it unknown when the gpu is done with data written for a frame. begin_frame() waits for the fence
+	* of the frame frames_in_flight() frames ago, end_frame() fences the current one, so per-frame data can live
+	* in frames_in_flight() slots of one buffer and be rewritten without orphaning:
+	*
+	*     context.frames_in_flight(2);               // 1 for the lowest latency, 2-3 for throughput
+	*     ...
+	*     GLuint slot = context.begin_frame();      // before writing anything the gpu may still read
+	*     uniforms.update(GL_UNIFORM_BUFFER, slot * slot_size, sizeof(frame_data), &frame_data);
+	*     uniforms.bind_range(GL_UNIFORM_BUFFER, 0, slot * slot_size, sizeof(frame_data));
+	*     ... draw ...
+	*     context.present();
+	*     context.end_frame();
+	*     glfwSwapBuffers(window);
+	*
+	*/
+
+	class context
+	{
+		GLbitfield _clear_bitfield;
+
+		bool _dsa;
+		depth_convention _depth;
+
+		GLuint _framebuffer;
+		GLuint _color;
+		GLuint _depth_buffer;
+		GLsizei _width;
+		GLsizei _height;
+
+		enum
+		{
+			max_frames_in_flight = 4
+		};
+
+		GLsync _fences[max_frames_in_flight];
+		GLuint _frames_in_flight;
+		std::uint64_t _frame;
+		// nanoseconds the last begin_frame() blocked
+		std::int64_t _waited;
+
+		void wait(GLsync& fence)
+		{
+			if (nullptr == fence)
+			{
+				return;
+			}
+
+			// flush once so the fence is sure to signal, then wait in slices until it does
+			GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+			for (;;)
+			{
+				GLenum status = glClientWaitSync(fence, flags, 1000000);
+				if (GL_TIMEOUT_EXPIRED != status)
+				{
+					break;
+				}
+				flags = 0;
+			}
+
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+
+		void wait_all()
+		{
+			for (GLsync& fence : _fences)
+			{
+				wait(fence);
+			}
+		}
+
+		void release_float_depth()
+		{
+			if (_framebuffer)
+			{
+				glDeleteFramebuffers(1, &_framebuffer);
+				glDeleteRenderbuffers(1, &_color);
+				glDeleteRenderbuffers(1, &_depth_buffer);
+
+				_framebuffer = _color = _depth_buffer = 0;
+			}
+		}
+
+	public:
+		explicit context(GLDEBUGPROC callback, const void* user_data = nullptr)
+			: _clear_bitfield(GL_COLOR_BUFFER_BIT)
+			, _dsa(capabilities::current().direct_state_access()), _depth(depth_convention::standard)
+			, _framebuffer(0), _color(0), _depth_buffer(0), _width(0), _height(0)
+			, _frames_in_flight(2), _frame(0), _waited(0)
+		{
+			for (GLsync& fence : _fences)
+			{
+				fence = nullptr;
+			}
+
+			glEnable(GL_DEBUG_OUTPUT);
+			glDebugMessageCallback(callback, user_data);
+		}
+
+		void wireframe_mode()
+		{
+			glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+		}
+
+		void testing_depth(bool testing = true)
+		{
+			if (testing)
+			{
+				_clear_bitfield = _clear_bitfield | GL_DEPTH_BUFFER_BIT;
+				glEnable(GL_DEPTH_TEST);
+			}
+			else
+			{
+				_clear_bitfield = _clear_bitfield & (GL_DEPTH_BUFFER_BIT ^ 0xFFFFFFFF);
+				glDisable(GL_DEPTH_TEST);
+			}
+		}
+
+		// false without clip control, the depth state is left as it is then
+		bool reverse_depth(bool reverse = true)
+		{
+			if (!capabilities::current().clip_control())
+			{
+				return false;
+			}
+
+			_depth = reverse ? depth_convention::reverse : depth_convention::standard;
+
+			glClipControl(GL_LOWER_LEFT, reverse ? GL_ZERO_TO_ONE : GL_NEGATIVE_ONE_TO_ONE);
+			glDepthFunc(reverse ? GL_GREATER : GL_LESS);
+			glClearDepth(reverse ? 0.0 : 1.0);
+
+			return true;
+		}
+
+		depth_convention depth() const
+		{
+			return _depth;
+		}
+
+		// render into an offscreen target with a 32 bit float depth buffer, call again to resize, false if it is incomplete
+		bool float_depth(GLsizei width, GLsizei height)
+		{
+			release_float_depth();
+
+			_width = width;
+			_height = height;
+
+			GLenum status = GL_FRAMEBUFFER_COMPLETE;
+			if (_dsa)
+			{
+				glCreateFramebuffers(1, &_framebuffer);
+				glCreateRenderbuffers(1, &_color);
+				glCreateRenderbuffers(1, &_depth_buffer);
+
+				glNamedRenderbufferStorage(_color, GL_RGBA8, width, height);
+				glNamedRenderbufferStorage(_depth_buffer, GL_DEPTH_COMPONENT32F, width, height);
+
+				glNamedFramebufferRenderbuffer(_framebuffer, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _color);
+				glNamedFramebufferRenderbuffer(_framebuffer, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _depth_buffer);
+
+				status = glCheckNamedFramebufferStatus(_framebuffer, GL_FRAMEBUFFER);
+				glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+			}
+			else
+			{
+				glGenFramebuffers(1, &_framebuffer);
+				glGenRenderbuffers(1, &_color);
+				glGenRenderbuffers(1, &_depth_buffer);
+
+				glBindRenderbuffer(GL_RENDERBUFFER, _color);
+				glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+				glBindRenderbuffer(GL_RENDERBUFFER, _depth_buffer);
+				glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32F, width, height);
+				glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+				glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+				glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _color);
+				glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _depth_buffer);
+
+				status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+			}
+
+			if (GL_FRAMEBUFFER_COMPLETE != status)
+			{
+				glBindFramebuffer(GL_FRAMEBUFFER, 0);
+				release_float_depth();
+				return false;
+			}
+
+			return true;
+		}
+
+		// the framebuffer drawn into, 0 for the window
+		GLuint framebuffer() const
+		{
+			return _framebuffer;
+		}
+
+		// copy the offscreen color to the window, nothing to do without float_depth()
+		void present()
+		{
+			if (0 == _framebuffer)
+			{
+				return;
+			}
+
+			if (_dsa)
+			{
+				glBlitNamedFramebuffer(_framebuffer, 0, 0, 0, _width, _height, 0, 0, _width, _height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+			}
+			else
+			{
+				glBindFramebuffer(GL_READ_FRAMEBUFFER, _framebuffer);
+				glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+				glBlitFramebuffer(0, 0, _width, _height, 0, 0, _width, _height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+				glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+			}
+		}
+
+		// how many frames the cpu may be ahead of the gpu, 1 to max_frames_in_flight, waits for the gpu to change it
+		void frames_in_flight(GLuint count)
+		{
+			count = count < 1 ? 1 : (count > max_frames_in_flight ? static_cast<GLuint>(max_frames_in_flight) : count);
+			if (count == _frames_in_flight)
+			{
+				return;
+			}
+
+			// the slots are renumbered, nothing may be in flight
+			wait_all();
+			_frames_in_flight = count;
+		}
+
+		GLuint frames_in_flight() const
+		{
+			return _frames_in_flight;
+		}
+
+		// waits until the gpu is done with the frame that used this slot before, returns the slot of this frame
+		GLuint begin_frame()
+		{
+			GLuint slot = frame_slot();
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			wait(_fences[slot]);
+			_waited = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+			return slot;
+		}
+
+		// after the last command of the frame, before the swap
+		void end_frame()
+		{
+			GLsync& fence = _fences[frame_slot()];
+			if (fence)
+			{
+				glDeleteSync(fence);
+			}
+			fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+			++_frame;
+		}
+
+		// which of the frames_in_flight() copies of per-frame data this frame writes
+		GLuint frame_slot() const
+		{
+			return static_cast<GLuint>(_frame % _frames_in_flight);
+		}
+
+		// frames ended so far
+		std::uint64_t frame() const
+		{
+			return _frame;
+		}
+
+		// seconds the last begin_frame() waited for the gpu, near zero when the cpu is the bottleneck
+		double waited() const
+		{
+			return static_cast<double>(_waited) * 1e-9;
+		}
+
+		void clear(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+		{
+			glClearColor(red, green, blue, alpha);
+			glClear(_clear_bitfield);
+		}
+
+		~context()
+		{
+			for (GLsync fence : _fences)
+			{
+				if (fence)
+				{
+					glDeleteSync(fence);
+				}
+			}
+
+			release_float_depth();
+		}
+
+	private:
+		context() = delete;
+		context(const context&) = delete;
+		context& operator=(const context&) = delete;
+		context(context&&) = delete;
+		context&& operator=(context&&) = delete;
+	};
+};
+
+#endif
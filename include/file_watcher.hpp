@@ -0,0 +1,313 @@
+
+#ifndef _GLIMPLIFY_FILE_WATCHER_H_
+#define _GLIMPLIFY_FILE_WATCHER_H_
+
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace glimplify {
+
+	/*
+	*
+	* Watches files from a background thread and reads them there once they changed, so the render thread
+	* only picks up finished contents. Linux uses inotify on the parent directories (editors often save by
+	* renaming a temporary file over the original), other systems poll the modification time.
+	* A change is read after the file stayed quiet for a short while, so half written files are skipped.
+	*
+	*/
+
+	class file_watcher
+	{
+		struct watched
+		{
+			std::string path;
+			std::string directory;
+			std::string name;
+
+			long long modified;
+			// when the last change was seen, 0 when there is nothing to read
+			long long touched;
+
+			bool ready;
+			std::string content;
+		};
+
+		enum
+		{
+			quiet_ms = 50,
+			poll_ms = 100
+		};
+
+		std::mutex _mutex;
+		std::vector<watched> _files;
+
+		std::atomic<bool> _running;
+		std::thread _thread;
+
+#ifdef __linux__
+		int _inotify;
+		std::vector<std::pair<int, std::string>> _directories;
+#endif
+
+		static long long now_ms()
+		{
+			return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		static long long modified_time(const std::string& path)
+		{
+			struct stat info;
+			if (0 != stat(path.c_str(), &info))
+			{
+				return -1;
+			}
+			return static_cast<long long>(info.st_mtime);
+		}
+
+		void touch(const std::string& directory, const std::string& name)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			for (watched& file : _files)
+			{
+				if (file.directory == directory && file.name == name)
+				{
+					file.touched = now_ms();
+				}
+			}
+		}
+
+		void scan()
+		{
+#ifdef __linux__
+			if (_inotify >= 0)
+			{
+				pollfd descriptor = { _inotify, POLLIN, 0 };
+				if (poll(&descriptor, 1, poll_ms) > 0)
+				{
+					alignas(inotify_event) char events[4096];
+					ssize_t length = ::read(_inotify, events, sizeof(events));
+
+					for (ssize_t offset = 0; offset < length; )
+					{
+						const inotify_event* event = reinterpret_cast<const inotify_event*>(events + offset);
+						offset += sizeof(inotify_event) + event->len;
+
+						if (event->len > 0)
+						{
+							std::string directory;
+							{
+								std::lock_guard<std::mutex> lock(_mutex);
+								for (const std::pair<int, std::string>& watch : _directories)
+								{
+									if (watch.first == event->wd)
+									{
+										directory = watch.second;
+									}
+								}
+							}
+							touch(directory, event->name);
+						}
+					}
+				}
+				return;
+			}
+#endif
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(poll_ms));
+
+			std::lock_guard<std::mutex> lock(_mutex);
+			for (watched& file : _files)
+			{
+				long long modified = modified_time(file.path);
+				if (modified != file.modified)
+				{
+					file.modified = modified;
+					file.touched = now_ms();
+				}
+			}
+		}
+
+		void collect()
+		{
+			std::vector<size_t> due;
+			std::vector<std::string> paths;
+			std::vector<long long> touched;
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				long long now = now_ms();
+				for (size_t i = 0; i < _files.size(); ++i)
+				{
+					if (_files[i].touched > 0 && now - _files[i].touched >= quiet_ms)
+					{
+						due.push_back(i);
+						paths.push_back(_files[i].path);
+						touched.push_back(_files[i].touched);
+					}
+				}
+			}
+
+			for (size_t i = 0; i < due.size(); ++i)
+			{
+				// read outside of the lock, the render thread may be taking other files meanwhile
+				std::ifstream stream(paths[i], std::ios::in | std::ios::binary);
+				std::ostringstream content;
+				bool read = static_cast<bool>(stream);
+				if (read)
+				{
+					content << stream.rdbuf();
+				}
+
+				// touched again while reading, the content may be from before that save, the next pass reads it again
+				std::lock_guard<std::mutex> lock(_mutex);
+				watched& file = _files[due[i]];
+				if (file.touched != touched[i])
+				{
+					continue;
+				}
+
+				file.touched = 0;
+				if (read)
+				{
+					file.content = content.str();
+					file.ready = true;
+				}
+			}
+		}
+
+		void run()
+		{
+			while (_running)
+			{
+				scan();
+				collect();
+			}
+		}
+
+	public:
+		file_watcher()
+			: _running(false)
+#ifdef __linux__
+			, _inotify(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+#endif
+		{
+		}
+
+		// returns the id used by take()
+		size_t watch(const std::string& path)
+		{
+			std::string::size_type slash = path.find_last_of("/\\");
+			std::string directory = std::string::npos == slash ? std::string(".") : path.substr(0, slash);
+			std::string name = std::string::npos == slash ? path : path.substr(slash + 1);
+
+			std::lock_guard<std::mutex> lock(_mutex);
+
+#ifdef __linux__
+			bool known = false;
+			for (const std::pair<int, std::string>& watch : _directories)
+			{
+				known = known || watch.second == directory;
+			}
+
+			if (!known && _inotify >= 0)
+			{
+				int descriptor = inotify_add_watch(_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+				if (descriptor >= 0)
+				{
+					_directories.push_back(std::make_pair(descriptor, directory));
+				}
+			}
+#endif
+
+			watched file = { path, directory, name, modified_time(path), 0, false, std::string() };
+			_files.push_back(file);
+
+			return _files.size() - 1;
+		}
+
+		void start()
+		{
+			if (!_running)
+			{
+				_running = true;
+				_thread = std::thread(&file_watcher::run, this);
+			}
+		}
+
+		void stop()
+		{
+			if (_running)
+			{
+				_running = false;
+				_thread.join();
+			}
+		}
+
+		// new contents of a changed file, true once per change
+		bool take(size_t id, std::string& content)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			watched& file = _files[id];
+			if (!file.ready)
+			{
+				return false;
+			}
+
+			content.swap(file.content);
+			file.content.clear();
+			file.ready = false;
+
+			return true;
+		}
+
+		// read a file synchronously, for the first load
+		static bool read(const std::string& path, std::string& content)
+		{
+			std::ifstream stream(path, std::ios::in | std::ios::binary);
+			if (!stream)
+			{
+				return false;
+			}
+
+			std::ostringstream buffer;
+			buffer << stream.rdbuf();
+			content = buffer.str();
+
+			return true;
+		}
+
+		~file_watcher()
+		{
+			stop();
+
+#ifdef __linux__
+			if (_inotify >= 0)
+			{
+				close(_inotify);
+			}
+#endif
+		}
+
+	private:
+		file_watcher(const file_watcher&) = delete;
+		file_watcher& operator=(const file_watcher&) = delete;
+		file_watcher(file_watcher&&) = delete;
+		file_watcher&& operator=(file_watcher&&) = delete;
+	};
+};
+
+#endif
@@ -0,0 +1,577 @@
+
+#ifndef _GLIMPLIFY_FRAME_GRAPH_H_
+#define _GLIMPLIFY_FRAME_GRAPH_H_
+
+#include "framebuffer.hpp"
+#include "memory_barriers.hpp"
+#include "texture.hpp"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace glimplify {
+
+	/*
+	*
+	* The passes of a frame declared with what they read and write, then compiled and executed in one go:
+	*
+	*   - writing a resource makes a new version of it, so reads name the exact write they depend on and the
+	*     passes can be declared in any order, they run in an order that respects every dependency;
+	*   - passes nothing needed reads from are culled, needed are side effect passes (e.g. the one drawing to the
+	*     window) and the producers of output() resources, which are imported ones, transients don't outlive the frame;
+	*   - transient textures come from the render target pool at their first use and go back after their last,
+	*     so transients of the same description whose lifetimes don't overlap share one texture;
+	*   - attachments are bound through a framebuffer kept per pass name; a transient is invalidated before its
+	*     first write and after its last use, so its contents are neither loaded nor stored;
+	*   - image writes get the memory barrier their later readers need, right before them.
+	*
+	* Declared again every frame, framebuffers and textures stay the same as long as the passes do:
+	*
+	*     graph.reset();
+	*     glimplify::frame_graph::resource hdr = graph.create("hdr", { width, height, GL_RGBA16F, 1 });
+	*     glimplify::frame_graph::resource depth = graph.create("depth", { width, height, GL_DEPTH_COMPONENT32F, 1 });
+	*
+	*     GLuint scene = graph.add_pass("scene", [&](glimplify::frame_graph& g, glimplify::framebuffer* target) {
+	*         target->clear_color(0, 0.0f, 0.0f, 0.0f, 1.0f);
+	*         target->clear_depth(1.0f);
+	*         ... draw ...
+	*     });
+	*     hdr = graph.write(scene, hdr, glimplify::frame_graph::usage::attachment, GL_COLOR_ATTACHMENT0);
+	*     depth = graph.write(scene, depth, glimplify::frame_graph::usage::attachment, GL_DEPTH_ATTACHMENT);
+	*
+	*     GLuint tonemap = graph.add_pass("tonemap", [&](glimplify::frame_graph& g, glimplify::framebuffer*) {
+	*         g.get(hdr).bind();
+	*         ... fullscreen triangle into the default framebuffer ...
+	*     }, true);
+	*     graph.read(tonemap, hdr);
+	*
+	*     graph.compile();
+	*     graph.execute();
+	*     pool.end_frame();
+	*
+	* The depth buffer is only written and never read after the scene pass, so it is invalidated right after it.
+	*
+	*/
+
+	class frame_graph
+	{
+	public:
+		// one version of a resource, what write() returns is the version later readers depend on
+		struct resource
+		{
+			GLuint index;
+			GLuint version;
+		};
+
+		enum class usage
+		{
+			// a framebuffer attachment of the pass, color or depth
+			attachment,
+			// texture fetches in a shader
+			sampled,
+			// imageLoad/imageStore, incoherent, writes are followed by a barrier
+			image
+		};
+
+		// the framebuffer with the pass's attachments bound, nullptr for passes without any
+		using callback = std::function<void(frame_graph&, framebuffer*)>;
+
+	private:
+		enum : GLuint
+		{
+			none = 0xFFFFFFFF
+		};
+
+		struct access
+		{
+			GLuint resource;
+			// the version read, or the version the write makes
+			GLuint version;
+			usage how;
+			GLenum point;
+			bool write;
+		};
+
+		struct pass
+		{
+			std::string name;
+			callback execute;
+			bool side_effect;
+			bool needed;
+
+			std::vector<access> accesses;
+		};
+
+		struct resource_node
+		{
+			std::string name;
+			render_target_desc desc;
+			texture* external;
+			texture* physical;
+
+			// producers[v] is the pass writing version v, version 0 is the contents before the frame
+			std::vector<GLuint> producers;
+
+			// positions in the execution order
+			GLuint first;
+			GLuint last;
+		};
+
+		// a pass's framebuffer and the points attached to it last time
+		struct target
+		{
+			std::unique_ptr<framebuffer> fbo;
+			std::vector<GLenum> points;
+		};
+
+		render_target_pool& _pool;
+		memory_barriers _barriers;
+
+		std::vector<pass> _passes;
+		std::vector<resource_node> _resources;
+		std::vector<resource> _outputs;
+		std::vector<GLuint> _order;
+
+		std::unordered_map<std::string, target> _targets;
+
+		static GLbitfield barrier_for(usage how)
+		{
+			switch (how)
+			{
+			case usage::attachment:
+				return GL_FRAMEBUFFER_BARRIER_BIT;
+			case usage::sampled:
+				return GL_TEXTURE_FETCH_BARRIER_BIT;
+			default:
+				return GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+			}
+		}
+
+		bool transient(GLuint index) const
+		{
+			return nullptr == _resources[index].external;
+		}
+
+		// the pass a version depends on, none for the contents before the frame
+		GLuint producer(GLuint index, GLuint version) const
+		{
+			return version < _resources[index].producers.size() ? _resources[index].producers[version] : static_cast<GLuint>(none);
+		}
+
+		void cull()
+		{
+			std::vector<GLuint> stack;
+			for (GLuint p = 0; p < _passes.size(); ++p)
+			{
+				_passes[p].needed = _passes[p].side_effect;
+				if (_passes[p].needed)
+				{
+					stack.push_back(p);
+				}
+			}
+
+			for (const resource& r : _outputs)
+			{
+				GLuint p = producer(r.index, r.version);
+				if (none != p && !_passes[p].needed)
+				{
+					_passes[p].needed = true;
+					stack.push_back(p);
+				}
+			}
+
+			// a needed pass needs the producers of what it reads, and of what it writes over
+			while (!stack.empty())
+			{
+				GLuint p = stack.back();
+				stack.pop_back();
+
+				for (const access& a : _passes[p].accesses)
+				{
+					GLuint dependency = producer(a.resource, a.write ? a.version - 1 : a.version);
+					if (none != dependency && !_passes[dependency].needed)
+					{
+						_passes[dependency].needed = true;
+						stack.push_back(dependency);
+					}
+				}
+			}
+		}
+
+		// topological order of the needed passes, ties go to the one declared first, false on a cycle
+		bool sort()
+		{
+			std::vector<std::vector<GLuint>> after(_passes.size());
+			std::vector<GLuint> waiting(_passes.size(), 0);
+
+			auto edge = [&](GLuint from, GLuint to) {
+				if (none != from && from != to && _passes[from].needed)
+				{
+					after[from].push_back(to);
+					++waiting[to];
+				}
+			};
+
+			// the needed passes reading every version, each pass once
+			std::vector<std::vector<std::vector<GLuint>>> readers(_resources.size());
+			for (GLuint r = 0; r < _resources.size(); ++r)
+			{
+				readers[r].resize(_resources[r].producers.size());
+			}
+
+			for (GLuint p = 0; p < _passes.size(); ++p)
+			{
+				for (const access& a : _passes[p].accesses)
+				{
+					if (_passes[p].needed && !a.write && a.version < readers[a.resource].size())
+					{
+						std::vector<GLuint>& list = readers[a.resource][a.version];
+						if (list.empty() || list.back() != p)
+						{
+							list.push_back(p);
+						}
+					}
+				}
+			}
+
+			for (GLuint p = 0; p < _passes.size(); ++p)
+			{
+				if (!_passes[p].needed)
+				{
+					continue;
+				}
+
+				for (const access& a : _passes[p].accesses)
+				{
+					if (a.write)
+					{
+						edge(producer(a.resource, a.version - 1), p);
+
+						// everyone reading the previous version reads it before it is written over
+						for (GLuint q : readers[a.resource][a.version - 1])
+						{
+							edge(q, p);
+						}
+					}
+					else
+					{
+						edge(producer(a.resource, a.version), p);
+					}
+				}
+			}
+
+			std::vector<bool> done(_passes.size(), false);
+			_order.clear();
+
+			size_t needed = 0;
+			for (const pass& p : _passes)
+			{
+				needed += p.needed ? 1 : 0;
+			}
+
+			while (_order.size() < needed)
+			{
+				GLuint next = none;
+				for (GLuint p = 0; p < _passes.size() && none == next; ++p)
+				{
+					if (_passes[p].needed && !done[p] && 0 == waiting[p])
+					{
+						next = p;
+					}
+				}
+
+				if (none == next)
+				{
+					return false;
+				}
+
+				done[next] = true;
+				_order.push_back(next);
+				for (GLuint p : after[next])
+				{
+					--waiting[p];
+				}
+			}
+
+			return true;
+		}
+
+		void lifetimes()
+		{
+			for (resource_node& r : _resources)
+			{
+				r.first = none;
+				r.last = 0;
+			}
+
+			for (GLuint i = 0; i < _order.size(); ++i)
+			{
+				for (const access& a : _passes[_order[i]].accesses)
+				{
+					resource_node& r = _resources[a.resource];
+					r.first = none == r.first ? i : r.first;
+					r.last = i;
+				}
+			}
+		}
+
+		framebuffer* bind_attachments(pass& p)
+		{
+			std::vector<GLenum> points;
+			for (const access& a : p.accesses)
+			{
+				if (usage::attachment == a.how)
+				{
+					points.push_back(a.point);
+				}
+			}
+
+			if (points.empty())
+			{
+				return nullptr;
+			}
+
+			target& t = _targets[p.name];
+			if (!t.fbo)
+			{
+				t.fbo.reset(new framebuffer());
+			}
+
+			for (GLenum point : t.points)
+			{
+				if (points.end() == std::find(points.begin(), points.end(), point))
+				{
+					t.fbo->detach(point);
+				}
+			}
+			t.points = points;
+
+			for (const access& a : p.accesses)
+			{
+				if (usage::attachment == a.how)
+				{
+					t.fbo->attach(a.point, get(resource{ a.resource, a.version }));
+				}
+			}
+
+			return t.fbo.get();
+		}
+
+	public:
+		// transient textures come from pool, which the caller ends the frame of
+		explicit frame_graph(render_target_pool& pool)
+			: _pool(pool)
+		{
+		}
+
+		// forget the declarations of the last frame, framebuffers are kept
+		void reset()
+		{
+			_passes.clear();
+			_resources.clear();
+			_outputs.clear();
+			_order.clear();
+		}
+
+		// a texture that only lives within the frame
+		resource create(const char* name, const render_target_desc& desc)
+		{
+			_resources.push_back(resource_node{ name, desc, nullptr, nullptr, std::vector<GLuint>(1, none), none, 0 });
+			return resource{ static_cast<GLuint>(_resources.size() - 1), 0 };
+		}
+
+		// a texture owned elsewhere, e.g. a shadow map or a history buffer, never aliased or invalidated
+		resource import(const char* name, texture& external)
+		{
+			render_target_desc desc = { external.width(), external.height(), GL_NONE, external.samples() };
+			_resources.push_back(resource_node{ name, desc, &external, nullptr, std::vector<GLuint>(1, none), none, 0 });
+			return resource{ static_cast<GLuint>(_resources.size() - 1), 0 };
+		}
+
+		// side_effect: never culled, e.g. it draws to the window or reads back to the cpu
+		GLuint add_pass(const char* name, callback execute, bool side_effect = false)
+		{
+			_passes.push_back(pass{ name, execute, side_effect, false, std::vector<access>() });
+			return static_cast<GLuint>(_passes.size() - 1);
+		}
+
+		// point: the attachment point when read as an attachment, e.g. a depth buffer only tested against
+		void read(GLuint pass_index, resource source, usage how = usage::sampled, GLenum point = GL_NONE)
+		{
+			_passes[pass_index].accesses.push_back(access{ source.index, source.version, how, point, false });
+		}
+
+		// writes over destination, which has to be the latest version, returns the new one. A stale version isn't
+		// written, the returned version is then 0xFFFFFFFF and names no write
+		resource write(GLuint pass_index, resource destination, usage how = usage::attachment, GLenum point = GL_COLOR_ATTACHMENT0)
+		{
+			resource_node& node = _resources[destination.index];
+			GLuint version = static_cast<GLuint>(node.producers.size());
+			if (destination.version + 1 != version)
+			{
+				return resource{ destination.index, none };
+			}
+
+			node.producers.push_back(pass_index);
+
+			_passes[pass_index].accesses.push_back(access{ destination.index, version, how, point, true });
+			return resource{ destination.index, version };
+		}
+
+		// this version of an imported texture is needed after the frame, its producers are not culled. False for
+		// transients, they go back to the pool within the frame, a result that has to stay is rendered into an import
+		bool output(resource r)
+		{
+			if (transient(r.index))
+			{
+				return false;
+			}
+
+			_outputs.push_back(r);
+			return true;
+		}
+
+		// cull, order and compute lifetimes, false if the dependencies have a cycle
+		bool compile()
+		{
+			cull();
+			if (!sort())
+			{
+				_order.clear();
+				return false;
+			}
+
+			lifetimes();
+			return true;
+		}
+
+		// run the compiled passes, passes without attachments start with default_framebuffer bound
+		void execute(GLuint default_framebuffer = 0)
+		{
+			std::vector<GLenum> discard;
+
+			for (GLuint i = 0; i < _order.size(); ++i)
+			{
+				pass& p = _passes[_order[i]];
+
+				for (const access& a : p.accesses)
+				{
+					resource_node& r = _resources[a.resource];
+					if (transient(a.resource) && nullptr == r.physical)
+					{
+						r.physical = &_pool.acquire(r.desc);
+					}
+				}
+
+				framebuffer* fbo = bind_attachments(p);
+
+				// transients hold nothing before their first write
+				discard.clear();
+				for (const access& a : p.accesses)
+				{
+					if (usage::attachment == a.how && a.write && transient(a.resource) && i == _resources[a.resource].first)
+					{
+						discard.push_back(a.point);
+					}
+
+					_barriers.before(barrier_for(a.how));
+				}
+
+				if (fbo)
+				{
+					fbo->invalidate(static_cast<GLsizei>(discard.size()), discard.data());
+					fbo->bind();
+				}
+				else
+				{
+					glBindFramebuffer(GL_FRAMEBUFFER, default_framebuffer);
+				}
+
+				p.execute(*this, fbo);
+
+				discard.clear();
+				for (const access& a : p.accesses)
+				{
+					if (usage::image == a.how && a.write)
+					{
+						_barriers.written(GL_FRAMEBUFFER_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+					}
+
+					if (usage::attachment == a.how && transient(a.resource) && i == _resources[a.resource].last)
+					{
+						discard.push_back(a.point);
+					}
+				}
+
+				// nothing reads them anymore, don't store them
+				if (fbo)
+				{
+					fbo->invalidate(static_cast<GLsizei>(discard.size()), discard.data());
+				}
+
+				for (const access& a : p.accesses)
+				{
+					resource_node& r = _resources[a.resource];
+					if (transient(a.resource) && i == r.last && r.physical)
+					{
+						_pool.release(*r.physical);
+						r.physical = nullptr;
+					}
+				}
+			}
+
+			for (resource_node& r : _resources)
+			{
+				if (r.physical)
+				{
+					_pool.release(*r.physical);
+					r.physical = nullptr;
+				}
+			}
+
+			glBindFramebuffer(GL_FRAMEBUFFER, default_framebuffer);
+		}
+
+		// the texture behind a resource, transients only between their first and last use
+		texture& get(resource r)
+		{
+			resource_node& node = _resources[r.index];
+			return node.external ? *node.external : *node.physical;
+		}
+
+		// the passes in execution order after compile(), culled ones left out
+		const std::vector<GLuint>& order() const
+		{
+			return _order;
+		}
+
+		size_t pass_count() const
+		{
+			return _passes.size();
+		}
+
+		const char* pass_name(GLuint pass_index) const
+		{
+			return _passes[pass_index].name.c_str();
+		}
+
+		~frame_graph()
+		{
+		}
+
+	private:
+		frame_graph() = delete;
+		frame_graph(const frame_graph&) = delete;
+		frame_graph& operator=(const frame_graph&) = delete;
+		frame_graph(frame_graph&&) = delete;
+		frame_graph&& operator=(frame_graph&&) = delete;
+	};
+};
+
+#endif
@@ -0,0 +1,226 @@
+
+#ifndef _GLIMPLIFY_FRAME_LOOP_H_
+#define _GLIMPLIFY_FRAME_LOOP_H_
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+namespace glimplify {
+
+	/*
+	*
+	* Simulation in fixed steps, rendering as often as it can (or as often as it is limited to), "Fix Your Timestep!".
+	* Time is counted in integer nanoseconds of the monotonic clock, so steps stay exact however long the program
+	* runs. A frame runs however many whole steps have accumulated, at most max_steps: after a hitch the excess is
+	* dropped instead of making the next frame even slower. Rendering blends the last two steps by alpha():
+	*
+	*     glimplify::frame_loop loop(1.0 / 60.0);
+	*     loop.limit(144.0);
+	*     while (running)
+	*     {
+	*         poll input
+	*         for (GLuint n = loop.begin_frame(); n > 0; --n)
+	*         {
+	*             previous = current;
+	*             simulate(current, loop.step());
+	*         }
+	*         render(glimplify::interpolate(previous, current, loop.alpha()));
+	*         loop.end_frame();            // sleeps, then spins, to the frame limit
+	*     }
+	*
+	*/
+
+	class frame_loop
+	{
+	public:
+		using clock = std::chrono::steady_clock;
+
+	private:
+		// nanoseconds
+		std::int64_t _step;
+		std::int64_t _accumulated;
+		std::int64_t _dropped;
+		std::int64_t _interval;
+		// how early before a deadline sleeping hands over to spinning, grows with the oversleeps seen
+		std::int64_t _spin;
+
+		GLuint _max_steps;
+		std::uint64_t _steps;
+
+		clock::time_point _last;
+		clock::time_point _deadline;
+
+		static std::int64_t nanoseconds(clock::duration d)
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+		}
+
+	public:
+		// step_seconds: simulated time per update, max_steps: updates a single frame may catch up with
+		explicit frame_loop(double step_seconds = 1.0 / 60.0, GLuint max_steps = 8)
+			: _step(static_cast<std::int64_t>(step_seconds * 1e9)), _accumulated(0), _dropped(0), _interval(0), _spin(1000000)
+			, _max_steps(max_steps > 0 ? max_steps : 1), _steps(0)
+			, _last(clock::now()), _deadline(_last)
+		{
+			_step = _step > 0 ? _step : 1;
+		}
+
+		// frames per second end_frame() waits for, 0 doesn't wait
+		void limit(double frames_per_second)
+		{
+			_interval = frames_per_second > 0.0 ? static_cast<std::int64_t>(1e9 / frames_per_second) : 0;
+			_deadline = clock::now();
+		}
+
+		// start counting from now, e.g. after loading, so the time spent isn't simulated
+		void reset()
+		{
+			_last = _deadline = clock::now();
+			_accumulated = 0;
+		}
+
+		// how many fixed steps to simulate this frame
+		GLuint begin_frame()
+		{
+			clock::time_point now = clock::now();
+			_accumulated += nanoseconds(now - _last);
+			_last = now;
+
+			std::int64_t steps = _accumulated / _step;
+			_accumulated -= steps * _step;
+
+			// past the cap the time is dropped, the simulation slows down instead of spiraling
+			if (steps > static_cast<std::int64_t>(_max_steps))
+			{
+				_dropped += (steps - _max_steps) * _step;
+				steps = _max_steps;
+			}
+
+			_steps += static_cast<std::uint64_t>(steps);
+			return static_cast<GLuint>(steps);
+		}
+
+		// wait for the frame limit: sleep while the deadline is far, spin the last part the scheduler can't hit
+		void end_frame()
+		{
+			if (0 == _interval)
+			{
+				return;
+			}
+
+			clock::time_point now = clock::now();
+			_deadline += std::chrono::nanoseconds(_interval);
+
+			// a missed frame starts a new schedule instead of rushing the next ones
+			if (_deadline <= now)
+			{
+				_deadline = now;
+				return;
+			}
+
+			clock::time_point wake = _deadline - std::chrono::nanoseconds(_spin);
+			if (wake > now)
+			{
+				std::this_thread::sleep_until(wake);
+
+				// jump up to a late wakeup at once, come down slowly
+				std::int64_t late = nanoseconds(clock::now() - wake);
+				_spin = std::max(late + late / 2, _spin - _spin / 16);
+				_spin = std::max<std::int64_t>(_spin, 100000);
+			}
+
+			while (clock::now() < _deadline)
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		// how far rendering is between the previous step and the last one, in [0, 1)
+		float alpha() const
+		{
+			return static_cast<float>(static_cast<double>(_accumulated) / static_cast<double>(_step));
+		}
+
+		// seconds per step, what each update advances
+		double step() const
+		{
+			return static_cast<double>(_step) * 1e-9;
+		}
+
+		// simulated seconds since the start
+		double time() const
+		{
+			return static_cast<double>(_steps) * step();
+		}
+
+		std::uint64_t steps() const
+		{
+			return _steps;
+		}
+
+		// seconds thrown away by the catch up cap, grows when the simulation can't keep up
+		double dropped() const
+		{
+			return static_cast<double>(_dropped) * 1e-9;
+		}
+
+		// the whole loop: update in fixed steps and render with alpha until running() says stop
+		void run(const std::function<bool()>& running, const std::function<void(double)>& update, const std::function<void(float)>& render)
+		{
+			reset();
+			while (running())
+			{
+				for (GLuint n = begin_frame(); n > 0; --n)
+				{
+					update(step());
+				}
+
+				render(alpha());
+				end_frame();
+			}
+		}
+
+		~frame_loop()
+		{
+		}
+
+	private:
+		frame_loop(const frame_loop&) = delete;
+		frame_loop& operator=(const frame_loop&) = delete;
+		frame_loop(frame_loop&&) = delete;
+		frame_loop&& operator=(frame_loop&&) = delete;
+	};
+
+	// an object's transform as the simulation keeps it, copied before every step to render in between
+	struct pose
+	{
+		glm::vec3 position;
+		glm::quat rotation;
+		glm::vec3 scale;
+	};
+
+	inline pose interpolate(const pose& previous, const pose& current, float alpha)
+	{
+		pose res;
+		res.position = glm::mix(previous.position, current.position, alpha);
+		res.rotation = glm::slerp(previous.rotation, current.rotation, alpha);
+		res.scale = glm::mix(previous.scale, current.scale, alpha);
+		return res;
+	}
+
+	inline glm::mat4 model_matrix(const pose& p)
+	{
+		return glm::scale(glm::translate(glm::mat4(1.0f), p.position) * glm::mat4_cast(p.rotation), p.scale);
+	}
+};
+
+#endif
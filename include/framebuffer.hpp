@@ -0,0 +1,587 @@
+
+#ifndef _GLIMPLIFY_FRAMEBUFFER_H_
+#define _GLIMPLIFY_FRAMEBUFFER_H_
+
+#include "capabilities.hpp"
+#include "texture.hpp"
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+namespace glimplify {
+
+	/*
+	*
+	* A framebuffer object over texture attachments. Multisampled passes render into GL_TEXTURE_2D_MULTISAMPLE
+	* textures and resolve() into a single sample framebuffer; invalidate() tells the driver the contents of
+	* attachments are not needed after the pass (multisampled color after the resolve, depth at the end of the
+	* frame), so tiled and bandwidth limited gpus skip writing them back:
+	*
+	*     scene.attach(GL_COLOR_ATTACHMENT0, msaa_color);
+	*     scene.attach(GL_DEPTH_ATTACHMENT, msaa_depth);
+	*     resolved.attach(GL_COLOR_ATTACHMENT0, color);
+	*
+	*     scene.bind();
+	*     scene.clear_color(0, 0.2f, 0.3f, 0.3f, 1.0f);
+	*     scene.clear_depth(1.0f);
+	*     ... draw ...
+	*     scene.resolve(resolved);
+	*     scene.invalidate({ GL_COLOR_ATTACHMENT0, GL_DEPTH_ATTACHMENT });
+	*
+	* Without direct state access edits bind the framebuffer to GL_DRAW_FRAMEBUFFER and restore the previous one.
+	* Attaching the texture that is already attached does nothing, so passes can attach every frame. A texture
+	* object created again since (new immutable storage, a name gl handed out again) is attached anew.
+	*
+	*/
+
+	class framebuffer
+	{
+		enum
+		{
+			max_color_attachments = 8,
+			// slots after the colors
+			depth_slot = max_color_attachments,
+			stencil_slot,
+			slot_count
+		};
+
+		struct attachment
+		{
+			GLuint id;
+			// texture::generation(), 0 for attachments by name which are never taken as unchanged
+			std::uint64_t generation;
+			GLint level;
+			GLint layer;
+		};
+
+		static bool same(const attachment& a, GLuint id, std::uint64_t generation, GLint level, GLint layer)
+		{
+			return a.id == id && a.level == level && a.layer == layer && (0 == id || (0 != generation && a.generation == generation));
+		}
+
+		bool _dsa;
+		bool _invalidate_subdata;
+
+		GLuint _id;
+
+		GLsizei _width;
+		GLsizei _height;
+		GLsizei _samples;
+
+		attachment _attached[slot_count];
+
+		static int slot(GLenum point)
+		{
+			if (GL_DEPTH_ATTACHMENT == point)
+			{
+				return depth_slot;
+			}
+
+			if (GL_STENCIL_ATTACHMENT == point)
+			{
+				return stencil_slot;
+			}
+
+			GLuint index = point - GL_COLOR_ATTACHMENT0;
+			return index < max_color_attachments ? static_cast<int>(index) : -1;
+		}
+
+		// the framebuffer is bound for editing from here until the returned previous one is restored
+		GLuint bind_for_edit() const
+		{
+			GLint previous = 0;
+			glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous);
+			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _id);
+
+			return static_cast<GLuint>(previous);
+		}
+
+		void texture_attachment(GLenum point, GLuint id, GLint level, GLint layer)
+		{
+			if (_dsa)
+			{
+				if (layer < 0)
+				{
+					glNamedFramebufferTexture(_id, point, id, level);
+				}
+				else
+				{
+					glNamedFramebufferTextureLayer(_id, point, id, level, layer);
+				}
+			}
+			else
+			{
+				GLuint previous = bind_for_edit();
+
+				if (layer < 0)
+				{
+					glFramebufferTexture(GL_DRAW_FRAMEBUFFER, point, id, level);
+				}
+				else
+				{
+					glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, point, id, level, layer);
+				}
+
+				glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previous);
+			}
+		}
+
+		// draw into every attached color in attachment order, read from the first one
+		void update_buffers()
+		{
+			GLenum buffers[max_color_attachments];
+			GLsizei count = 0;
+			for (GLsizei i = 0; i < max_color_attachments; ++i)
+			{
+				buffers[i] = GL_NONE;
+				if (_attached[i].id)
+				{
+					buffers[i] = GL_COLOR_ATTACHMENT0 + i;
+					count = i + 1;
+				}
+			}
+
+			GLenum read = count > 0 ? buffers[0] : GL_NONE;
+			if (0 == count)
+			{
+				count = 1;
+			}
+
+			if (_dsa)
+			{
+				glNamedFramebufferDrawBuffers(_id, count, buffers);
+				glNamedFramebufferReadBuffer(_id, read);
+			}
+			else
+			{
+				GLuint previous = bind_for_edit();
+
+				glDrawBuffers(count, buffers);
+
+				GLint previous_read = 0;
+				glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previous_read);
+				glBindFramebuffer(GL_READ_FRAMEBUFFER, _id);
+				glReadBuffer(read);
+				glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(previous_read));
+
+				glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previous);
+			}
+		}
+
+	public:
+		framebuffer()
+			: _dsa(capabilities::current().direct_state_access())
+			, _invalidate_subdata(capabilities::current().invalidate_subdata())
+			, _id(0), _width(0), _height(0), _samples(1)
+		{
+			for (attachment& a : _attached)
+			{
+				a = attachment{ 0, 0, 0, -1 };
+			}
+
+			if (_dsa)
+			{
+				glCreateFramebuffers(1, &_id);
+			}
+			else
+			{
+				// a generated name only becomes a framebuffer once it is bound
+				glGenFramebuffers(1, &_id);
+				GLuint previous = bind_for_edit();
+				glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previous);
+			}
+		}
+
+		/*
+		*
+		* point: GL_COLOR_ATTACHMENTi, GL_DEPTH_ATTACHMENT, GL_STENCIL_ATTACHMENT or GL_DEPTH_STENCIL_ATTACHMENT.
+		* layer: one layer of an array texture, -1 attaches all of them for layered rendering.
+		* The framebuffer takes the size and sample count of the last attachment, they must all agree.
+		*
+		*/
+		void attach(GLenum point, const texture& source, GLint level = 0, GLint layer = -1)
+		{
+			attach(point, source.id(), source.generation(), level, layer);
+
+			_width = source.width() >> level > 0 ? source.width() >> level : 1;
+			_height = source.height() >> level > 0 ? source.height() >> level : 1;
+			_samples = source.samples();
+		}
+
+		void detach(GLenum point)
+		{
+			attach(point, 0, 0, -1);
+		}
+
+		// by texture name, the size isn't known here, see size(). A name can't be told from a reused one, so it is always attached
+		void attach(GLenum point, GLuint id, GLint level, GLint layer)
+		{
+			attach(point, id, 0, level, layer);
+		}
+
+		void attach(GLenum point, GLuint id, std::uint64_t generation, GLint level, GLint layer)
+		{
+			if (GL_DEPTH_STENCIL_ATTACHMENT == point)
+			{
+				attachment& depth = _attached[depth_slot];
+				attachment& stencil = _attached[stencil_slot];
+				if (same(depth, id, generation, level, layer) && same(stencil, id, generation, level, layer))
+				{
+					return;
+				}
+
+				depth = stencil = attachment{ id, generation, level, layer };
+				texture_attachment(point, id, level, layer);
+				return;
+			}
+
+			int index = slot(point);
+			if (index < 0)
+			{
+				return;
+			}
+
+			attachment& current = _attached[index];
+			if (same(current, id, generation, level, layer))
+			{
+				return;
+			}
+
+			bool color_changed = index < max_color_attachments && (0 == current.id) != (0 == id);
+
+			current = attachment{ id, generation, level, layer };
+			texture_attachment(point, id, level, layer);
+
+			if (color_changed)
+			{
+				update_buffers();
+			}
+		}
+
+		// GL_FRAMEBUFFER_COMPLETE or the reason it isn't
+		GLenum status() const
+		{
+			if (_dsa)
+			{
+				return glCheckNamedFramebufferStatus(_id, GL_DRAW_FRAMEBUFFER);
+			}
+
+			GLuint previous = bind_for_edit();
+			GLenum res = glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER);
+			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previous);
+
+			return res;
+		}
+
+		bool complete() const
+		{
+			return GL_FRAMEBUFFER_COMPLETE == status();
+		}
+
+		// render into it over its whole size
+		void bind()
+		{
+			glBindFramebuffer(GL_FRAMEBUFFER, _id);
+			glViewport(0, 0, _width, _height);
+		}
+
+		// back to the window, its viewport is the caller's to restore
+		void unbind()
+		{
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		}
+
+		void clear_color(GLint draw_buffer, GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+		{
+			GLfloat value[4] = { red, green, blue, alpha };
+			if (_dsa)
+			{
+				glClearNamedFramebufferfv(_id, GL_COLOR, draw_buffer, value);
+			}
+			else
+			{
+				GLuint previous = bind_for_edit();
+				glClearBufferfv(GL_COLOR, draw_buffer, value);
+				glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previous);
+			}
+		}
+
+		// the depth write mask must be on for the clear to take effect
+		void clear_depth(GLfloat depth)
+		{
+			if (_dsa)
+			{
+				glClearNamedFramebufferfv(_id, GL_DEPTH, 0, &depth);
+			}
+			else
+			{
+				GLuint previous = bind_for_edit();
+				glClearBufferfv(GL_DEPTH, 0, &depth);
+				glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previous);
+			}
+		}
+
+		// which color attachment blit() and resolve() copy from, GL_COLOR_ATTACHMENT0 unless changed
+		void read_buffer(GLenum point)
+		{
+			if (_dsa)
+			{
+				glNamedFramebufferReadBuffer(_id, point);
+			}
+			else
+			{
+				GLint previous = 0;
+				glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previous);
+				glBindFramebuffer(GL_READ_FRAMEBUFFER, _id);
+				glReadBuffer(point);
+				glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(previous));
+			}
+		}
+
+		/*
+		*
+		* Copy the whole framebuffer into a rectangle of target (0 is the window), scaled with filter.
+		* Depth and stencil only copy with GL_NEAREST, multisampled sources only to a rectangle of the same size.
+		*
+		*/
+		void blit(GLuint target, GLint x0, GLint y0, GLint x1, GLint y1, GLbitfield mask = GL_COLOR_BUFFER_BIT, GLenum filter = GL_NEAREST)
+		{
+			if (_dsa)
+			{
+				glBlitNamedFramebuffer(_id, target, 0, 0, _width, _height, x0, y0, x1, y1, mask, filter);
+			}
+			else
+			{
+				GLint previous_read = 0, previous_draw = 0;
+				glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previous_read);
+				glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous_draw);
+
+				glBindFramebuffer(GL_READ_FRAMEBUFFER, _id);
+				glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target);
+				glBlitFramebuffer(0, 0, _width, _height, x0, y0, x1, y1, mask, filter);
+
+				glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(previous_read));
+				glBindFramebuffer(GL_DRAW_FRAMEBUFFER, static_cast<GLuint>(previous_draw));
+			}
+		}
+
+		// multisample resolve, or a plain copy, into a framebuffer of the same size
+		void resolve(const framebuffer& target, GLbitfield mask = GL_COLOR_BUFFER_BIT)
+		{
+			blit(target.id(), 0, 0, target.width(), target.height(), mask, GL_NEAREST);
+		}
+
+		/*
+		*
+		* The contents of these attachments are undefined from here until they are drawn again, which saves the
+		* store of a tile or a compressed surface. Does nothing without GL 4.3 or ARB_invalidate_subdata.
+		*
+		*/
+		void invalidate(GLsizei count, const GLenum* points)
+		{
+			if (!_invalidate_subdata || count <= 0)
+			{
+				return;
+			}
+
+			if (_dsa)
+			{
+				glInvalidateNamedFramebufferData(_id, count, points);
+			}
+			else
+			{
+				GLuint previous = bind_for_edit();
+				glInvalidateFramebuffer(GL_DRAW_FRAMEBUFFER, count, points);
+				glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previous);
+			}
+		}
+
+		void invalidate(std::initializer_list<GLenum> points)
+		{
+			invalidate(static_cast<GLsizei>(points.size()), points.begin());
+		}
+
+		// for attachments made by texture name
+		void size(GLsizei width, GLsizei height, GLsizei samples = 1)
+		{
+			_width = width;
+			_height = height;
+			_samples = samples;
+		}
+
+		GLuint id() const
+		{
+			return _id;
+		}
+
+		GLsizei width() const
+		{
+			return _width;
+		}
+
+		GLsizei height() const
+		{
+			return _height;
+		}
+
+		GLsizei samples() const
+		{
+			return _samples;
+		}
+
+		~framebuffer()
+		{
+			glDeleteFramebuffers(1, &_id);
+		}
+
+	private:
+		framebuffer(const framebuffer&) = delete;
+		framebuffer& operator=(const framebuffer&) = delete;
+		framebuffer(framebuffer&&) = delete;
+		framebuffer&& operator=(framebuffer&&) = delete;
+	};
+
+	// what a pooled render target is, textures only stand in for each other when all of it matches
+	struct render_target_desc
+	{
+		GLsizei width;
+		GLsizei height;
+		// sized internal format, e.g. GL_RGBA16F or GL_DEPTH_COMPONENT32F
+		GLenum format;
+		GLsizei samples;
+	};
+
+	inline bool operator==(const render_target_desc& lhs, const render_target_desc& rhs)
+	{
+		return lhs.width == rhs.width && lhs.height == rhs.height && lhs.format == rhs.format && lhs.samples == rhs.samples;
+	}
+
+	/*
+	*
+	* Transient render targets shared by the passes of a frame and kept from frame to frame. A pass acquires what
+	* it renders into and releases it once the last pass reading it is done, a later pass asking for the same
+	* description then gets the same texture. Textures are handed out in the order they were created, so with the
+	* same passes every frame each one gets the same textures as in the last frame and its framebuffer attachments
+	* don't change. Textures no pass asked for in max_idle_frames frames are deleted, e.g. after a resize:
+	*
+	*     glimplify::texture& bright = pool.acquire({ width / 2, height / 2, GL_RGBA16F, 1 });
+	*     bloom.attach(GL_COLOR_ATTACHMENT0, bright);
+	*     ... render bloom, composite reads bright ...
+	*     pool.release(bright);
+	*     ...
+	*     pool.end_frame();
+	*
+	* Single sample targets are clamped to the edge and filtered linearly without mipmaps, ready to be sampled.
+	*
+	*/
+
+	class render_target_pool
+	{
+		struct entry
+		{
+			std::unique_ptr<texture> target;
+			render_target_desc desc;
+			bool acquired;
+			GLuint64 last_used;
+		};
+
+		GLuint _max_idle_frames;
+		GLuint64 _frame;
+
+		std::vector<entry> _entries;
+
+	public:
+		explicit render_target_pool(GLuint max_idle_frames = 3)
+			: _max_idle_frames(max_idle_frames), _frame(0)
+		{
+		}
+
+		// texture_unit: where the texture binds when a later pass samples it
+		texture& acquire(const render_target_desc& desc, GLenum texture_unit = 0)
+		{
+			for (entry& e : _entries)
+			{
+				if (!e.acquired && e.desc == desc)
+				{
+					e.acquired = true;
+					e.last_used = _frame;
+					e.target->texture_unit(texture_unit);
+					return *e.target;
+				}
+			}
+
+			std::unique_ptr<texture> target(new texture(texture_unit, desc.samples > 1 ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D));
+			if (desc.samples > 1)
+			{
+				target->storage_multisample(desc.samples, desc.format, desc.width, desc.height);
+			}
+			else
+			{
+				target->wrap_mode(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+				target->filter_mode(GL_LINEAR, GL_LINEAR);
+				target->storage(1, desc.format, desc.width, desc.height);
+			}
+
+			_entries.push_back(entry{ std::move(target), desc, true, _frame });
+			return *_entries.back().target;
+		}
+
+		// free for the next acquire of the same description, in this frame already
+		void release(const texture& target)
+		{
+			for (entry& e : _entries)
+			{
+				if (e.target.get() == &target)
+				{
+					e.acquired = false;
+					return;
+				}
+			}
+		}
+
+		// every target is released, the ones idle for too long are deleted
+		void end_frame()
+		{
+			size_t kept = 0;
+			for (size_t i = 0; i < _entries.size(); ++i)
+			{
+				entry& e = _entries[i];
+				e.acquired = false;
+
+				if (_frame - e.last_used < _max_idle_frames)
+				{
+					if (kept != i)
+					{
+						_entries[kept] = std::move(e);
+					}
+					++kept;
+				}
+			}
+			_entries.erase(_entries.begin() + kept, _entries.end());
+
+			++_frame;
+		}
+
+		// textures alive, in use or not
+		size_t size() const
+		{
+			return _entries.size();
+		}
+
+		~render_target_pool()
+		{
+		}
+
+	private:
+		render_target_pool(const render_target_pool&) = delete;
+		render_target_pool& operator=(const render_target_pool&) = delete;
+		render_target_pool(render_target_pool&&) = delete;
+		render_target_pool&& operator=(render_target_pool&&) = delete;
+	};
+};
+
+#endif
@@ -0,0 +1,308 @@
+
+#ifndef _GLIMPLIFY_GPU_CULLING_H_
+#define _GLIMPLIFY_GPU_CULLING_H_
+
+#include "bounds.hpp"
+#include "hiz_pyramid.hpp"
+#include "memory_barriers.hpp"
+#include "program.hpp"
+
+#include <glm/glm.hpp>
+
+#include <string>
+
+#ifndef GL_PARAMETER_BUFFER
+#define GL_PARAMETER_BUFFER 0x80EE
+#endif
+
+namespace glimplify {
+
+	// one object to cull, std430 layout of the objects buffer, count/first_index/base_vertex come from buffer_heap
+	struct cull_object
+	{
+		glm::vec4 sphere;
+		GLuint count;
+		GLuint first_index;
+		GLint base_vertex;
+		GLuint reserved;
+	};
+
+	static_assert(sizeof(cull_object) == 32, "cull_object must match its std430 layout");
+
+	// layout of glMultiDrawElementsIndirect commands
+	struct draw_elements_indirect_command
+	{
+		GLuint count;
+		GLuint instance_count;
+		GLuint first_index;
+		GLint base_vertex;
+		GLuint base_instance;
+	};
+
+	/*
+	*
+	* Frustum culling on the gpu: a compute pass tests the bounding sphere of every object and writes the draw
+	* commands of the visible ones, the draw reads them without the cpu ever seeing the result.
+	* With indirect parameters (gl 4.6) visible objects are compacted through an atomic counter that becomes the
+	* draw count of glMultiDrawElementsIndirectCount. Otherwise every object keeps its command slot and invisible ones
+	* get an instance count of 0, drawn with glMultiDrawElementsIndirect.
+	*
+	* With a hiz_pyramid, objects hidden behind the depth of an earlier frame are rejected as well.
+	*
+	* Every command's base instance is its slot, and visible() holds the object index of every slot, so the
+	* vertex shader gets its object through a per instance attribute:
+	*
+	*     format.stream<glimplify::layout<glimplify::attr<GLuint>>>(1, 1);       // divisor 1
+	*     ...
+	*     culling.cull(camera.view_frustum(), barriers);
+	*     format.bind();
+	*     format.bind_vertices(0, vertex_heap.page(0));
+	*     format.bind_vertices(1, culling.visible());
+	*     format.bind_index(index_heap.page(0));
+	*     culling.draw(GL_TRIANGLES, GL_UNSIGNED_SHORT, barriers);
+	*
+	* All objects have to live in the same vertex and index buffers.
+	*
+	*/
+
+	class gpu_culling
+	{
+		static const GLuint group_size = 64;
+
+		bool _compact;
+
+		GLuint _capacity;
+		GLuint _object_count;
+
+		program _program;
+
+		buffer _objects;
+		buffer _commands;
+		buffer _visible;
+		buffer _draw_count;
+
+		static std::string source(bool compact)
+		{
+			std::string res = "#version 430 core\n";
+			if (compact)
+			{
+				res += "#define COMPACT\n";
+			}
+
+			return res +
+				"layout(local_size_x = 64) in;\n"
+				"struct cull_object { vec4 sphere; uint count; uint first_index; int base_vertex; uint reserved; };\n"
+				"struct draw_command { uint count; uint instance_count; uint first_index; int base_vertex; uint base_instance; };\n"
+				"layout(std430, binding = 0) readonly buffer objects_block { cull_object objects[]; };\n"
+				"layout(std430, binding = 1) writeonly buffer commands_block { draw_command commands[]; };\n"
+				"layout(std430, binding = 2) writeonly buffer visible_block { uint visible[]; };\n"
+				"layout(binding = 0, offset = 0) uniform atomic_uint draw_count;\n"
+				"uniform vec4 planes[6];\n"
+				"uniform uint object_count;\n"
+				"uniform uint occlusion;\n"
+				"uniform mat4 view_projection;\n"
+				"uniform sampler2D hiz;\n"
+				"uniform vec2 hiz_size;\n"
+				"uniform float hiz_levels;\n"
+				"uniform uint reverse_depth;\n"
+				"bool unoccluded(vec4 sphere)\n"
+				"{\n"
+				"    vec3 lo = vec3(1.0), hi = vec3(-1.0);\n"
+				"    for (int i = 0; i < 8; ++i)\n"
+				"    {\n"
+				"        vec3 corner = sphere.xyz + sphere.w * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);\n"
+				"        vec4 clip = view_projection * vec4(corner, 1.0);\n"
+				"        if (clip.w <= 0.0) return true;\n"
+				"        lo = min(lo, clip.xyz / clip.w);\n"
+				"        hi = max(hi, clip.xyz / clip.w);\n"
+				"    }\n"
+				"    vec2 uv_lo = clamp(lo.xy * 0.5 + 0.5, 0.0, 1.0);\n"
+				"    vec2 uv_hi = clamp(hi.xy * 0.5 + 0.5, 0.0, 1.0);\n"
+				"    vec2 size = (uv_hi - uv_lo) * hiz_size;\n"
+				"    // at this level the rectangle covers at most 2x2 texels\n"
+				"    float level = clamp(ceil(log2(max(max(size.x, size.y), 1.0))), 0.0, hiz_levels - 1.0);\n"
+				"    vec4 depths = vec4(textureLod(hiz, uv_lo, level).r, textureLod(hiz, vec2(uv_hi.x, uv_lo.y), level).r,\n"
+				"                       textureLod(hiz, vec2(uv_lo.x, uv_hi.y), level).r, textureLod(hiz, uv_hi, level).r);\n"
+				"    // reverse depth: farther is smaller and ndc z is the depth\n"
+				"    if (0u != reverse_depth) return hi.z >= min(min(depths.x, depths.y), min(depths.z, depths.w));\n"
+				"    return lo.z * 0.5 + 0.5 <= max(max(depths.x, depths.y), max(depths.z, depths.w));\n"
+				"}\n"
+				"void main()\n"
+				"{\n"
+				"    uint id = gl_GlobalInvocationID.x;\n"
+				"    if (id >= object_count) return;\n"
+				"    cull_object o = objects[id];\n"
+				"    bool inside = true;\n"
+				"    for (int i = 0; i < 6; ++i)\n"
+				"    {\n"
+				"        inside = inside && dot(planes[i].xyz, o.sphere.xyz) + planes[i].w >= -o.sphere.w;\n"
+				"    }\n"
+				"    inside = inside && (0u == occlusion || unoccluded(o.sphere));\n"
+				"#ifdef COMPACT\n"
+				"    if (!inside) return;\n"
+				"    uint slot = atomicCounterIncrement(draw_count);\n"
+				"#else\n"
+				"    uint slot = id;\n"
+				"    if (inside) atomicCounterIncrement(draw_count);\n"
+				"#endif\n"
+				"    commands[slot] = draw_command(o.count, inside ? 1u : 0u, o.first_index, o.base_vertex, slot);\n"
+				"    visible[slot] = id;\n"
+				"}\n";
+		}
+
+		// run the bound culling program
+		void dispatch(const frustum& view, memory_barriers& barriers)
+		{
+			// the previous cull incremented the counter from a shader, the reset is a buffer update
+			barriers.before(GL_BUFFER_UPDATE_BARRIER_BIT);
+			const GLuint zero = 0;
+			_draw_count.update(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(GLuint), &zero);
+
+			_program.set_uniform_4fv("planes", 6, view.planes);
+			_program.set_uniform_1ui("object_count", _object_count);
+
+			_objects.bind_base(GL_SHADER_STORAGE_BUFFER, 0);
+			_commands.bind_base(GL_SHADER_STORAGE_BUFFER, 1);
+			_visible.bind_base(GL_SHADER_STORAGE_BUFFER, 2);
+			_draw_count.bind_base(GL_ATOMIC_COUNTER_BUFFER, 0);
+
+			_program.dispatch((_object_count + group_size - 1) / group_size);
+			_program.unbind();
+
+			barriers.written(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+		}
+
+
+		// the core entry point from 4.6, the ARB one before
+		void draw_count(GLenum mode, GLenum index_type)
+		{
+#if defined(GL_ARB_indirect_parameters)
+			if (!capabilities::current().version(4, 6))
+			{
+				glMultiDrawElementsIndirectCountARB(mode, index_type, nullptr, 0, static_cast<GLsizei>(_object_count), 0);
+				return;
+			}
+#endif
+			glMultiDrawElementsIndirectCount(mode, index_type, nullptr, 0, static_cast<GLsizei>(_object_count), 0);
+		}
+
+	public:
+		// capacity: the most objects that can be culled at once
+		explicit gpu_culling(GLuint capacity)
+			: _compact(capabilities::current().indirect_parameters())
+			, _capacity(capacity), _object_count(0)
+		{
+			// storage and atomic counter buffers don't exist either, compile() reports it
+			if (!capabilities::current().compute_shader())
+			{
+				_capacity = 0;
+				return;
+			}
+
+			_objects.allocate(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(capacity) * sizeof(cull_object), nullptr, GL_DYNAMIC_DRAW);
+			_commands.allocate(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(capacity) * sizeof(draw_elements_indirect_command), nullptr, GL_DYNAMIC_COPY);
+			_visible.allocate(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(capacity) * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+			_draw_count.allocate(GL_ATOMIC_COUNTER_BUFFER, sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+		}
+
+		// false without compute shaders, nothing else may be called then
+		bool compile(GLsizei length, GLchar* desc)
+		{
+			return _program.compile_compute(source(_compact).c_str(), length, desc);
+		}
+
+		// replace the objects, at most capacity
+		void objects(const cull_object* data, GLuint count)
+		{
+			_object_count = count < _capacity ? count : _capacity;
+			_objects.update(GL_SHADER_STORAGE_BUFFER, 0, static_cast<GLsizeiptr>(_object_count) * sizeof(cull_object), data);
+		}
+
+		// update the objects [first, first + count), e.g. the ones that moved
+		void update_objects(GLuint first, const cull_object* data, GLuint count)
+		{
+			_objects.update(GL_SHADER_STORAGE_BUFFER, static_cast<GLintptr>(first) * sizeof(cull_object), static_cast<GLsizeiptr>(count) * sizeof(cull_object), data);
+		}
+
+		void cull(const frustum& view, memory_barriers& barriers)
+		{
+			_program.bind();
+			_program.set_uniform_1ui("occlusion", 0);
+
+			dispatch(view, barriers);
+		}
+
+		// frustum and occlusion culling against a pyramid built from an earlier frame
+		void cull(const frustum& view, const glm::mat4& view_projection, hiz_pyramid& hiz, memory_barriers& barriers)
+		{
+			barriers.before(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+			_program.bind();
+			hiz.bind();
+			_program.set_uniform_1ui("occlusion", 1);
+			_program.set_uniform_matrix4fv("view_projection", view_projection);
+			_program.set_uniform_1i("hiz", static_cast<GLint>(hiz.texture_unit()));
+			_program.set_uniform_2fv("hiz_size", glm::vec2(static_cast<float>(hiz.width()), static_cast<float>(hiz.height())));
+			_program.set_uniform_1f("hiz_levels", static_cast<float>(hiz.levels()));
+			_program.set_uniform_1ui("reverse_depth", depth_convention::reverse == hiz.convention() ? 1 : 0);
+
+			dispatch(view, barriers);
+		}
+
+		// draw the culled objects with the bound vertex array and draw program
+		void draw(GLenum mode, GLenum index_type, memory_barriers& barriers)
+		{
+			barriers.before(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+			_commands.bind(GL_DRAW_INDIRECT_BUFFER);
+			if (_compact)
+			{
+				_draw_count.bind(GL_PARAMETER_BUFFER);
+				draw_count(mode, index_type);
+			}
+			else
+			{
+				glMultiDrawElementsIndirect(mode, index_type, nullptr, static_cast<GLsizei>(_object_count), 0);
+			}
+		}
+
+		// visible objects of the last cull, reading it back waits for the gpu, so only for statistics
+		GLuint visible_count(memory_barriers& barriers) const
+		{
+			barriers.before(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+			GLuint res = 0;
+			_draw_count.read(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(GLuint), &res);
+			return res;
+		}
+
+		// object index per command slot, the per instance attribute of the draw
+		buffer& visible()
+		{
+			return _visible;
+		}
+
+		bool compact() const
+		{
+			return _compact;
+		}
+
+		GLuint object_count() const
+		{
+			return _object_count;
+		}
+
+		~gpu_culling()
+		{
+		}
+
+	private:
+		gpu_culling() = delete;
+		gpu_culling(const gpu_culling&) = delete;
+		gpu_culling& operator=(const gpu_culling&) = delete;
+		gpu_culling(gpu_culling&&) = delete;
+		gpu_culling&& operator=(gpu_culling&&) = delete;
+	};
+};
+
+#endif
@@ -0,0 +1,303 @@
+
+#ifndef _GLIMPLIFY_HIZ_PYRAMID_H_
+#define _GLIMPLIFY_HIZ_PYRAMID_H_
+
+#include "bounds.hpp"
+#include "memory_barriers.hpp"
+#include "program.hpp"
+#include "texture.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace glimplify {
+
+	/*
+	*
+	* Hierarchical depth for occlusion culling. The depth buffer of a rendered frame is copied into a texture
+	* and reduced into an R32F mip chain where every texel keeps the farthest depth of the texels it covers.
+	* A box is hidden when its nearest depth is behind the farthest depth of the few texels of the level where
+	* its screen rectangle is about 2x2 texels. Usually built from the previous frame, so objects that become
+	* visible show up one frame late:
+	*
+	*     glimplify::hiz_pyramid hiz(SCR_WIDTH, SCR_HEIGHT, 2);
+	*     hiz.compile(512, desc);
+	*     ...
+	*     culling.cull(camera.view_frustum(), view_projection, hiz, barriers);   // on the gpu
+	*     draw the scene
+	*     hiz.build(barriers);                                                   // from the depth just drawn
+	*
+	* Or on the cpu: hiz.readback(level, barriers) once per frame and hiz.visible(box, view_projection) per object.
+	*
+	* With reverse depth the farthest depth is the smallest one, so the pyramid keeps the minimum instead.
+	*
+	*/
+
+	class hiz_pyramid
+	{
+		GLsizei _width;
+		GLsizei _height;
+		GLsizei _levels;
+		depth_convention _convention;
+
+		texture _depth;
+		texture _pyramid;
+
+		program _seed;
+		program _reduce;
+
+		std::vector<float> _readback;
+		GLsizei _readback_width;
+		GLsizei _readback_height;
+
+		static std::string source(bool seed, depth_convention convention)
+		{
+			std::string res = "#version 430 core\n";
+			if (seed)
+			{
+				res += "#define SEED\n";
+			}
+			if (depth_convention::reverse == convention)
+			{
+				res += "#define REVERSE_DEPTH\n";
+			}
+
+			return res +
+				"layout(local_size_x = 8, local_size_y = 8) in;\n"
+				"layout(r32f, binding = 0) uniform writeonly image2D destination;\n"
+				"#ifdef SEED\n"
+				"uniform sampler2D source_depth;\n"
+				"#else\n"
+				"layout(r32f, binding = 1) uniform readonly image2D source;\n"
+				"#endif\n"
+				"uniform ivec2 source_size;\n"
+				"uniform ivec2 destination_size;\n"
+				"void main()\n"
+				"{\n"
+				"    ivec2 p = ivec2(gl_GlobalInvocationID.xy);\n"
+				"    if (any(greaterThanEqual(p, destination_size))) return;\n"
+				"#ifdef SEED\n"
+				"    imageStore(destination, p, vec4(texelFetch(source_depth, p, 0).r));\n"
+				"#else\n"
+				"    // odd sources fold their last row and column into the last destination texel\n"
+				"    ivec2 extent = ivec2(2) + ivec2(equal(p, destination_size - 1)) * (source_size & 1);\n"
+				"#ifdef REVERSE_DEPTH\n"
+				"    float res = 1.0;\n"
+				"#else\n"
+				"    float res = 0.0;\n"
+				"#endif\n"
+				"    for (int y = 0; y < extent.y; ++y)\n"
+				"    {\n"
+				"        for (int x = 0; x < extent.x; ++x)\n"
+				"        {\n"
+				"            float depth = imageLoad(source, min(p * 2 + ivec2(x, y), source_size - 1)).r;\n"
+				"#ifdef REVERSE_DEPTH\n"
+				"            res = min(res, depth);\n"
+				"#else\n"
+				"            res = max(res, depth);\n"
+				"#endif\n"
+				"        }\n"
+				"    }\n"
+				"    imageStore(destination, p, vec4(res));\n"
+				"#endif\n"
+				"}\n";
+		}
+
+		static GLsizei level_size(GLsizei size, GLint level)
+		{
+			return std::max(size >> level, 1);
+		}
+
+	public:
+		// width, height: size of the depth buffer, texture_unit: where the pyramid is bound for the gpu test
+		explicit hiz_pyramid(GLsizei width, GLsizei height, GLenum texture_unit, depth_convention convention = depth_convention::standard)
+			: _width(0), _height(0), _levels(0), _convention(convention)
+			, _depth(texture_unit), _pyramid(texture_unit)
+			, _readback_width(0), _readback_height(0)
+		{
+			resize(width, height);
+		}
+
+		// false without compute shaders, build() may not be called then
+		bool compile(GLsizei length, GLchar* desc)
+		{
+			return _seed.compile_compute(source(true, _convention).c_str(), length, desc) && _reduce.compile_compute(source(false, _convention).c_str(), length, desc);
+		}
+
+		// follow the framebuffer size
+		void resize(GLsizei width, GLsizei height)
+		{
+			_width = width;
+			_height = height;
+
+			_levels = 1;
+			for (GLsizei size = std::max(width, height); size > 1; size >>= 1)
+			{
+				++_levels;
+			}
+
+			_depth.filter_mode(GL_NEAREST, GL_NEAREST);
+			_depth.storage(1, GL_DEPTH_COMPONENT32F, width, height);
+
+			_pyramid.filter_mode(GL_NEAREST_MIPMAP_NEAREST, GL_NEAREST);
+			_pyramid.wrap_mode(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+			_pyramid.storage(_levels, GL_R32F, width, height);
+
+			_readback.clear();
+		}
+
+		// copy the depth of the read framebuffer and reduce it, nothing waits for the gpu
+		void build(memory_barriers& barriers)
+		{
+			_depth.copy_framebuffer(0, 0, 0, _width, _height);
+
+			_seed.bind();
+			_depth.bind();
+			_seed.set_uniform_1i("source_depth", static_cast<GLint>(_depth.texture_unit()));
+			_seed.set_uniform_2iv("source_size", glm::ivec2(_width, _height));
+			_seed.set_uniform_2iv("destination_size", glm::ivec2(_width, _height));
+			_pyramid.bind_image(0, 0, GL_WRITE_ONLY, GL_R32F);
+			_seed.dispatch_threads(_width, _height);
+			barriers.written(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+			_reduce.bind();
+			for (GLint level = 1; level < _levels; ++level)
+			{
+				glm::ivec2 source_size(level_size(_width, level - 1), level_size(_height, level - 1));
+				glm::ivec2 destination_size(level_size(_width, level), level_size(_height, level));
+
+				// every level reads the one written just before
+				barriers.before(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+				_reduce.set_uniform_2iv("source_size", source_size);
+				_reduce.set_uniform_2iv("destination_size", destination_size);
+				_pyramid.bind_image(0, level, GL_WRITE_ONLY, GL_R32F);
+				_pyramid.bind_image(1, level - 1, GL_READ_ONLY, GL_R32F);
+				_reduce.dispatch_threads(destination_size.x, destination_size.y);
+				barriers.written(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+			}
+			_reduce.unbind();
+
+			// sampled by the gpu culling pass or read back
+			barriers.written(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+		}
+
+		// bind the pyramid to its texture unit for sampling
+		void bind()
+		{
+			_pyramid.bind();
+		}
+
+		GLenum texture_unit() const
+		{
+			return _pyramid.texture_unit();
+		}
+
+		GLsizei width() const
+		{
+			return _width;
+		}
+
+		GLsizei height() const
+		{
+			return _height;
+		}
+
+		GLsizei levels() const
+		{
+			return _levels;
+		}
+
+		depth_convention convention() const
+		{
+			return _convention;
+		}
+
+		/*
+		*
+		* Copy one level to the cpu for visible(), this waits for the gpu to finish the pyramid.
+		* A level around 64 texels wide keeps the copy small and still rejects most hidden objects.
+		*
+		*/
+		void readback(GLint level, memory_barriers& barriers)
+		{
+			level = std::min(level, _levels - 1);
+
+			barriers.before(GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+			_readback_width = level_size(_width, level);
+			_readback_height = level_size(_height, level);
+			_readback.resize(static_cast<size_t>(_readback_width) * _readback_height);
+
+			_pyramid.read(level, GL_RED, GL_FLOAT, static_cast<GLsizei>(_readback.size() * sizeof(float)), _readback.data());
+		}
+
+		// false when the box is certainly hidden behind the depth of the last readback
+		bool visible(const bounding_box& box, const glm::mat4& view_projection) const
+		{
+			if (_readback.empty())
+			{
+				return true;
+			}
+
+			glm::vec3 lo(1.0f), hi(-1.0f);
+			for (int corner = 0; corner < 8; ++corner)
+			{
+				glm::vec3 p((corner & 1) ? box.max.x : box.min.x, (corner & 2) ? box.max.y : box.min.y, (corner & 4) ? box.max.z : box.min.z);
+				glm::vec4 clip = view_projection * glm::vec4(p, 1.0f);
+				if (clip.w <= 0.0f)
+				{
+					// crosses the camera plane, can't be tested
+					return true;
+				}
+
+				glm::vec3 ndc = glm::vec3(clip) / clip.w;
+				lo = glm::min(lo, ndc);
+				hi = glm::max(hi, ndc);
+			}
+
+			if (hi.x < -1.0f || hi.y < -1.0f || lo.x > 1.0f || lo.y > 1.0f)
+			{
+				// outside of the screen, frustum culling decides
+				return true;
+			}
+
+			GLint x0 = std::max(0, static_cast<GLint>(std::floor((lo.x * 0.5f + 0.5f) * _readback_width)));
+			GLint y0 = std::max(0, static_cast<GLint>(std::floor((lo.y * 0.5f + 0.5f) * _readback_height)));
+			GLint x1 = std::min(_readback_width - 1, static_cast<GLint>(std::floor((hi.x * 0.5f + 0.5f) * _readback_width)));
+			GLint y1 = std::min(_readback_height - 1, static_cast<GLint>(std::floor((hi.y * 0.5f + 0.5f) * _readback_height)));
+
+			bool reverse = depth_convention::reverse == _convention;
+
+			float farthest = reverse ? 1.0f : 0.0f;
+			for (GLint y = y0; y <= y1; ++y)
+			{
+				for (GLint x = x0; x <= x1; ++x)
+				{
+					float depth = _readback[static_cast<size_t>(y) * _readback_width + x];
+					farthest = reverse ? std::min(farthest, depth) : std::max(farthest, depth);
+				}
+			}
+
+			// ndc z is the depth itself with clip control zero to one
+			return reverse ? hi.z >= farthest : lo.z * 0.5f + 0.5f <= farthest;
+		}
+
+		~hiz_pyramid()
+		{
+		}
+
+	private:
+		hiz_pyramid() = delete;
+		hiz_pyramid(const hiz_pyramid&) = delete;
+		hiz_pyramid& operator=(const hiz_pyramid&) = delete;
+		hiz_pyramid(hiz_pyramid&&) = delete;
+		hiz_pyramid&& operator=(hiz_pyramid&&) = delete;
+	};
+};
+
+#endif
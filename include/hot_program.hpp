@@ -0,0 +1,151 @@
+
+#ifndef _GLIMPLIFY_HOT_PROGRAM_H_
+#define _GLIMPLIFY_HOT_PROGRAM_H_
+
+#include "file_watcher.hpp"
+#include "program.hpp"
+
+#include <cstdio>
+#include <memory>
+#include <string>
+
+namespace glimplify {
+
+	/*
+	*
+	* A program built from shader files that rebuilds itself when they change. The new sources are linked into
+	* a second program and only swapped in once the link succeeded, with the uniform values of the running one,
+	* so a broken edit keeps the last working shader on screen. References to get() stay valid across swaps.
+	*
+	*     glimplify::file_watcher watcher;
+	*     glimplify::hot_program shader(watcher, "shaders/cube.vert", "shaders/cube.frag");
+	*     shader.load(512, desc);
+	*     watcher.start();
+	*     ...
+	*     // every frame
+	*     if (glimplify::hot_program::status::failed == shader.update(512, desc)) { ... }
+	*     shader.get().bind();
+	*
+	*/
+
+	class hot_program
+	{
+	public:
+		enum class status
+		{
+			unchanged,
+			compiling,
+			swapped,
+			failed
+		};
+
+	private:
+		file_watcher& _watcher;
+
+		std::string _vertex_path;
+		std::string _fragment_path;
+
+		size_t _vertex_id;
+		size_t _fragment_id;
+
+		std::string _vertex_source;
+		std::string _fragment_source;
+
+		program _live;
+		std::unique_ptr<program> _candidate;
+		// a candidate is resolved one update() after its submit at the earliest, so the frame submitting it doesn't wait
+		bool _submitted;
+
+	public:
+		explicit hot_program(file_watcher& watcher, const std::string& vertex_path, const std::string& fragment_path)
+			: _watcher(watcher)
+			, _vertex_path(vertex_path), _fragment_path(fragment_path)
+			, _vertex_id(watcher.watch(vertex_path)), _fragment_id(watcher.watch(fragment_path))
+			, _submitted(false)
+		{
+		}
+
+		// read and link the files now, waiting for the compiler
+		bool load(GLsizei length, GLchar* desc)
+		{
+			if (!file_watcher::read(_vertex_path, _vertex_source))
+			{
+				snprintf(desc, length, "can not read %s", _vertex_path.c_str());
+				return false;
+			}
+
+			if (!file_watcher::read(_fragment_path, _fragment_source))
+			{
+				snprintf(desc, length, "can not read %s", _fragment_path.c_str());
+				return false;
+			}
+
+			return _live.compile(_vertex_source.c_str(), _fragment_source.c_str(), length, desc);
+		}
+
+		/*
+		*
+		* Call once per frame on the gl thread. Changed files restart the build of the candidate program,
+		* a finished candidate replaces the live program when it linked, desc holds the log when it failed.
+		* Only with KHR_parallel_shader_compile is the candidate polled until the driver is done; without it the
+		* update() that swaps blocks in the compile and link, a hitch of that one frame per saved edit.
+		*
+		*/
+		status update(GLsizei length, GLchar* desc)
+		{
+			bool changed = _watcher.take(_vertex_id, _vertex_source);
+			changed = _watcher.take(_fragment_id, _fragment_source) || changed;
+
+			if (changed)
+			{
+				// an outdated candidate is dropped, deleting a program that is still compiling doesn't wait for it
+				_candidate.reset(new program());
+				_candidate->submit(_vertex_source.c_str(), _fragment_source.c_str());
+				_submitted = true;
+
+				return status::compiling;
+			}
+
+			if (!_candidate)
+			{
+				return status::unchanged;
+			}
+
+			// ready() asks for GL_COMPLETION_STATUS_KHR only with the extension, otherwise resolve() below waits
+			if (_submitted || !_candidate->ready())
+			{
+				_submitted = false;
+				return status::compiling;
+			}
+
+			std::unique_ptr<program> candidate(std::move(_candidate));
+			if (!candidate->resolve(length, desc))
+			{
+				return status::failed;
+			}
+
+			candidate->copy_uniforms(_live);
+			_live.swap(*candidate);
+
+			return status::swapped;
+		}
+
+		program& get()
+		{
+			return _live;
+		}
+
+		~hot_program()
+		{
+		}
+
+	private:
+		hot_program() = delete;
+		hot_program(const hot_program&) = delete;
+		hot_program& operator=(const hot_program&) = delete;
+		hot_program(hot_program&&) = delete;
+		hot_program&& operator=(hot_program&&) = delete;
+	};
+};
+
+#endif
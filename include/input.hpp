@@ -0,0 +1,320 @@
+
+#ifndef _GLIMPLIFY_INPUT_H_
+#define _GLIMPLIFY_INPUT_H_
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+
+namespace glimplify {
+
+	/*
+	*
+	* Single producer, single consumer ring of fixed capacity, a power of two. push() and pop() never block or
+	* allocate, the producer only writes the tail and the consumer only the head.
+	*
+	*/
+
+	template <typename T, size_t Capacity>
+	class spsc_queue
+	{
+		static_assert(Capacity > 0 && 0 == (Capacity & (Capacity - 1)), "capacity is a power of two");
+
+		T _items[Capacity];
+
+		// apart, so producer and consumer don't share a cache line
+		alignas(64) std::atomic<size_t> _head;
+		alignas(64) std::atomic<size_t> _tail;
+
+	public:
+		spsc_queue()
+			: _head(0), _tail(0)
+		{
+		}
+
+		// false when full, the item is dropped
+		bool push(const T& item)
+		{
+			size_t tail = _tail.load(std::memory_order_relaxed);
+			if (tail - _head.load(std::memory_order_acquire) == Capacity)
+			{
+				return false;
+			}
+
+			_items[tail & (Capacity - 1)] = item;
+			_tail.store(tail + 1, std::memory_order_release);
+
+			return true;
+		}
+
+		// false when empty
+		bool pop(T& item)
+		{
+			size_t head = _head.load(std::memory_order_relaxed);
+			if (head == _tail.load(std::memory_order_acquire))
+			{
+				return false;
+			}
+
+			item = _items[head & (Capacity - 1)];
+			_head.store(head + 1, std::memory_order_release);
+
+			return true;
+		}
+
+		~spsc_queue()
+		{
+		}
+
+	private:
+		spsc_queue(const spsc_queue&) = delete;
+		spsc_queue& operator=(const spsc_queue&) = delete;
+		spsc_queue(spsc_queue&&) = delete;
+		spsc_queue&& operator=(spsc_queue&&) = delete;
+	};
+
+	struct input_event
+	{
+		enum class kind : std::uint8_t
+		{
+			key,
+			button,
+			scroll
+		};
+
+		kind type;
+		// key or mouse button code and action (0 release, 1 press, 2 repeat, as glfw has them)
+		int code;
+		int action;
+		// scroll offsets
+		double x;
+		double y;
+	};
+
+	/*
+	*
+	* Window callbacks only record what happened, once per frame update() folds it into the state of the frame:
+	* one cursor delta, one scroll offset and which keys are down, went down or came up. However many events a
+	* 1000Hz mouse delivers, the camera then changes once per frame:
+	*
+	*     glfwSetCursorPosCallback(window, [](GLFWwindow*, double x, double y) { events.cursor(x, y); });
+	*     glfwSetKeyCallback(window, [](GLFWwindow*, int key, int, int action, int) { events.key(key, action); });
+	*     ...
+	*     events.update();
+	*     glm::vec2 delta = events.cursor_delta() * 0.1f;
+	*     glm::vec3 move(events.down(GLFW_KEY_D) - events.down(GLFW_KEY_A), 0.0f, events.down(GLFW_KEY_W) - events.down(GLFW_KEY_S));
+	*     camera.transform(move * delta_time, -delta.y, delta.x);
+	*
+	* The callbacks may run on another thread than update(), as long as it is a single one. Cursor moves don't go
+	* through the queue, only the latest position is kept, so a flood of them never pushes out a key release.
+	*
+	*/
+
+	class input
+	{
+	public:
+		enum
+		{
+			queue_capacity = 1024,
+			// covers GLFW_KEY_LAST
+			key_count = 512,
+			button_count = 8
+		};
+
+	private:
+		spsc_queue<input_event, queue_capacity> _events;
+		std::atomic<std::uint32_t> _dropped;
+
+		// the latest cursor position from the producer and how many moves led there since the last update()
+		std::atomic<double> _latest_x;
+		std::atomic<double> _latest_y;
+		std::atomic<std::uint32_t> _cursor_moves;
+
+		std::bitset<key_count> _down;
+		std::bitset<key_count> _pressed;
+		std::bitset<key_count> _released;
+		std::bitset<button_count> _buttons;
+
+		// the cursor is absolute in the events, the first one after a recenter() only sets where it is
+		bool _has_cursor;
+		double _cursor_x;
+		double _cursor_y;
+		glm::vec2 _cursor_delta;
+		glm::vec2 _scroll;
+
+		std::uint32_t _processed;
+
+		void push(const input_event& e)
+		{
+			if (!_events.push(e))
+			{
+				_dropped.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+	public:
+		input()
+			: _dropped(0)
+			, _latest_x(0.0), _latest_y(0.0), _cursor_moves(0)
+			, _has_cursor(false), _cursor_x(0.0), _cursor_y(0.0), _cursor_delta(0.0f), _scroll(0.0f)
+			, _processed(0)
+		{
+		}
+
+		// producer side, straight from the window callbacks
+
+		void cursor(double x, double y)
+		{
+			_latest_x.store(x, std::memory_order_relaxed);
+			_latest_y.store(y, std::memory_order_relaxed);
+			_cursor_moves.fetch_add(1, std::memory_order_release);
+		}
+
+		void key(int code, int action)
+		{
+			push(input_event{ input_event::kind::key, code, action, 0.0, 0.0 });
+		}
+
+		void button(int code, int action)
+		{
+			push(input_event{ input_event::kind::button, code, action, 0.0, 0.0 });
+		}
+
+		void scroll(double x, double y)
+		{
+			push(input_event{ input_event::kind::scroll, 0, 0, x, y });
+		}
+
+		// consumer side, once per frame: drain the queue into this frame's state
+		void update()
+		{
+			_pressed.reset();
+			_released.reset();
+			_cursor_delta = glm::vec2(0.0f);
+			_scroll = glm::vec2(0.0f);
+			_processed = 0;
+
+			// positions are absolute, so the delta to the latest one is the sum of all moves, in double precision.
+			// x and y may come from two different moves, the next frame's delta makes up for it
+			std::uint32_t moves = _cursor_moves.exchange(0, std::memory_order_acquire);
+			if (moves > 0)
+			{
+				double x = _latest_x.load(std::memory_order_relaxed);
+				double y = _latest_y.load(std::memory_order_relaxed);
+				if (_has_cursor)
+				{
+					_cursor_delta = glm::vec2(static_cast<float>(x - _cursor_x), static_cast<float>(y - _cursor_y));
+				}
+				_has_cursor = true;
+				_cursor_x = x;
+				_cursor_y = y;
+				_processed += moves;
+			}
+
+			input_event e;
+			while (_events.pop(e))
+			{
+				++_processed;
+
+				switch (e.type)
+				{
+				case input_event::kind::key:
+					// repeats keep the key down, a press and release within one frame still counts as pressed
+					if (e.code >= 0 && e.code < key_count && 2 != e.action)
+					{
+						if (1 == e.action)
+						{
+							_pressed.set(e.code, !_down.test(e.code) || _pressed.test(e.code));
+							_down.set(e.code);
+						}
+						else
+						{
+							_released.set(e.code, _down.test(e.code) || _released.test(e.code));
+							_down.reset(e.code);
+						}
+					}
+					break;
+
+				case input_event::kind::button:
+					if (e.code >= 0 && e.code < button_count && 2 != e.action)
+					{
+						_buttons.set(e.code, 1 == e.action);
+					}
+					break;
+
+				case input_event::kind::scroll:
+					_scroll += glm::vec2(static_cast<float>(e.x), static_cast<float>(e.y));
+					break;
+				}
+			}
+		}
+
+		// the next cursor event only sets the position, e.g. after capturing the cursor
+		void recenter()
+		{
+			_has_cursor = false;
+		}
+
+		// window coordinates moved this frame, x to the right, y down
+		glm::vec2 cursor_delta() const
+		{
+			return _cursor_delta;
+		}
+
+		glm::vec2 scroll() const
+		{
+			return _scroll;
+		}
+
+		bool down(int code) const
+		{
+			return code >= 0 && code < key_count && _down.test(code);
+		}
+
+		// went down this frame
+		bool pressed(int code) const
+		{
+			return code >= 0 && code < key_count && _pressed.test(code);
+		}
+
+		// came up this frame
+		bool released(int code) const
+		{
+			return code >= 0 && code < key_count && _released.test(code);
+		}
+
+		bool button_down(int code) const
+		{
+			return code >= 0 && code < button_count && _buttons.test(code);
+		}
+
+		// events folded into the last update()
+		std::uint32_t processed() const
+		{
+			return _processed;
+		}
+
+		// events lost to a full queue, update() isn't called often enough if this grows
+		std::uint32_t dropped() const
+		{
+			return _dropped.load(std::memory_order_relaxed);
+		}
+
+		~input()
+		{
+		}
+
+	private:
+		input(const input&) = delete;
+		input& operator=(const input&) = delete;
+		input(input&&) = delete;
+		input&& operator=(input&&) = delete;
+	};
+};
+
+#endif
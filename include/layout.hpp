@@ -0,0 +1,177 @@
+
+#ifndef _GLIMPLIFY_LAYOUT_H_
+#define _GLIMPLIFY_LAYOUT_H_
+
+#include "size_of.hpp"
+
+#include <glm/glm.hpp>
+
+#include <utility>
+
+namespace glimplify {
+
+	/*
+	*
+	* A vertex layout is described by its attribute types, for example
+	*
+	*     using cube_layout = glimplify::layout<glimplify::attr<glm::vec3>, glimplify::attr<glm::vec2>>;
+	*
+	* stride, offsets, gl types and normalization are all resolved at compile time,
+	* so setting up the vertex array is a single call without any runtime bookkeeping.
+	*
+	*/
+
+	template <GLenum Type, GLint Size, bool Integer = false, bool Normalized = false>
+	struct attribute_format
+	{
+		static constexpr GLenum type = Type;
+		static constexpr GLint size = Size;
+		// integer attributes are read as int/uint in the shader via glVertexAttribIPointer
+		static constexpr bool integer = Integer;
+		// normalized formats (unorm/snorm) are always fed to the shader as float in [0, 1] or [-1, 1]
+		static constexpr bool normalized = Normalized;
+	};
+
+	template <typename T>
+	struct attribute_traits;
+
+	template <> struct attribute_traits<GLfloat> : attribute_format<GL_FLOAT, 1> {};
+	template <> struct attribute_traits<glm::vec2> : attribute_format<GL_FLOAT, 2> {};
+	template <> struct attribute_traits<glm::vec3> : attribute_format<GL_FLOAT, 3> {};
+	template <> struct attribute_traits<glm::vec4> : attribute_format<GL_FLOAT, 4> {};
+
+	template <> struct attribute_traits<GLint> : attribute_format<GL_INT, 1, true> {};
+	template <> struct attribute_traits<glm::ivec2> : attribute_format<GL_INT, 2, true> {};
+	template <> struct attribute_traits<glm::ivec3> : attribute_format<GL_INT, 3, true> {};
+	template <> struct attribute_traits<glm::ivec4> : attribute_format<GL_INT, 4, true> {};
+
+	template <> struct attribute_traits<GLuint> : attribute_format<GL_UNSIGNED_INT, 1, true> {};
+	template <> struct attribute_traits<glm::uvec2> : attribute_format<GL_UNSIGNED_INT, 2, true> {};
+	template <> struct attribute_traits<glm::uvec3> : attribute_format<GL_UNSIGNED_INT, 3, true> {};
+	template <> struct attribute_traits<glm::uvec4> : attribute_format<GL_UNSIGNED_INT, 4, true> {};
+
+	template <typename T, bool Normalized = false>
+	struct attr
+	{
+		using value_type = T;
+
+		static constexpr GLenum type = attribute_traits<T>::type;
+		static constexpr GLint size = attribute_traits<T>::size;
+		static constexpr GLsizei bytes = static_cast<GLsizei>(sizeof(T));
+		static constexpr GLboolean normalized = (Normalized || attribute_traits<T>::normalized) ? GL_TRUE : GL_FALSE;
+		// normalized integers are converted to float, so only plain integers go through the integer path
+		static constexpr bool integer = attribute_traits<T>::integer && GL_FALSE == normalized;
+
+		static_assert(size >= 1 && size <= 4, "vertex attribute must have 1 to 4 components");
+		static_assert(size_of(type, size) == bytes, "vertex attribute type does not match its gl format");
+		static_assert(GL_FALSE == normalized || (GL_FLOAT != type && GL_HALF_FLOAT != type && GL_DOUBLE != type), "floating point vertex attribute can not be normalized");
+		static_assert(!packed(type) || 4 == size, "packed vertex attribute always has 4 components");
+	};
+
+	template <typename... Attributes>
+	struct layout
+	{
+		static_assert(sizeof...(Attributes) > 0, "vertex layout needs at least one attribute");
+
+		static constexpr GLuint count = static_cast<GLuint>(sizeof...(Attributes));
+
+		static constexpr GLsizei offset(GLuint index)
+		{
+			const GLsizei bytes[] = { Attributes::bytes... };
+
+			GLsizei res = 0;
+			for (GLuint i = 0; i < index && i < count; ++i)
+			{
+				res += bytes[i];
+			}
+
+			return res;
+		}
+
+		static constexpr GLsizei stride()
+		{
+			return offset(count);
+		}
+
+		// true when a vertex struct is laid out exactly like this layout
+		template <typename Vertex>
+		static constexpr bool matches()
+		{
+			return sizeof(Vertex) == static_cast<size_t>(stride());
+		}
+
+		// calls function(attribute, index, offset) for every attribute, attribute is a default constructed attr<...>
+		template <typename Function>
+		static void for_each(Function function)
+		{
+			for_each(function, std::make_index_sequence<sizeof...(Attributes)>());
+		}
+
+		// point the attributes [first_index, first_index + count) of the bound vertex array to the bound array buffer,
+		// the vertices start `base` bytes into it
+		static void apply(GLuint first_index = 0, GLintptr base = 0)
+		{
+			for_each([first_index, base](auto attribute, GLuint index, GLsizei attribute_offset) {
+				using attribute_type = decltype(attribute);
+
+				if (attribute_type::integer)
+				{
+					glVertexAttribIPointer(first_index + index, attribute_type::size, attribute_type::type, stride(), (const void*)(base + attribute_offset));
+				}
+				else
+				{
+					glVertexAttribPointer(first_index + index, attribute_type::size, attribute_type::type, attribute_type::normalized, stride(), (const void*)(base + attribute_offset));
+				}
+				glEnableVertexAttribArray(first_index + index);
+			});
+		}
+
+		// vertex attrib binding version (gl 4.3), the attributes of the bound vertex array read from buffer binding slot `binding`
+		static void apply_format(GLuint binding, GLuint first_index = 0)
+		{
+			for_each([binding, first_index](auto attribute, GLuint index, GLsizei attribute_offset) {
+				using attribute_type = decltype(attribute);
+
+				if (attribute_type::integer)
+				{
+					glVertexAttribIFormat(first_index + index, attribute_type::size, attribute_type::type, attribute_offset);
+				}
+				else
+				{
+					glVertexAttribFormat(first_index + index, attribute_type::size, attribute_type::type, attribute_type::normalized, attribute_offset);
+				}
+				glVertexAttribBinding(first_index + index, binding);
+				glEnableVertexAttribArray(first_index + index);
+			});
+		}
+
+		// direct state access version, the attributes of `vao` read from its buffer binding slot `binding`
+		static void apply_named(GLuint vao, GLuint binding, GLuint first_index = 0)
+		{
+			for_each([vao, binding, first_index](auto attribute, GLuint index, GLsizei attribute_offset) {
+				using attribute_type = decltype(attribute);
+
+				if (attribute_type::integer)
+				{
+					glVertexArrayAttribIFormat(vao, first_index + index, attribute_type::size, attribute_type::type, attribute_offset);
+				}
+				else
+				{
+					glVertexArrayAttribFormat(vao, first_index + index, attribute_type::size, attribute_type::type, attribute_type::normalized, attribute_offset);
+				}
+				glVertexArrayAttribBinding(vao, first_index + index, binding);
+				glEnableVertexArrayAttrib(vao, first_index + index);
+			});
+		}
+
+	private:
+		template <typename Function, size_t... Indices>
+		static void for_each(Function& function, std::index_sequence<Indices...>)
+		{
+			int expand[] = { 0, (function(Attributes(), static_cast<GLuint>(Indices), offset(static_cast<GLuint>(Indices))), 0)... };
+			(void)expand;
+		}
+	};
+};
+
+#endif
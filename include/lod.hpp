@@ -0,0 +1,266 @@
+
+#ifndef _GLIMPLIFY_LOD_H_
+#define _GLIMPLIFY_LOD_H_
+
+#include "bounds.hpp"
+#include "camera.hpp"
+#include "mesh.hpp"
+#include "simplify.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace glimplify {
+
+	/*
+	*
+	* Levels of detail as index ranges into one index buffer over shared vertices, level 0 is the full mesh.
+	* The chain is built offline (tools/simplify.cpp writes it next to the mesh) and picked per object and frame
+	* by the projected error in pixels:
+	*
+	*     glimplify::lod_mesh rock;
+	*     glimplify::load_lod_mesh("rock.lod", rock);
+	*     glimplify::index_buffer indices = glimplify::narrow_indices(rock.mesh.indices.data(), rock.mesh.indices.size());
+	*     vertices.allocate_vertices(rock.mesh.vertices.size(), rock.mesh.vertices.data(), GL_STATIC_DRAW);
+	*     vertices.allocate_index(indices, GL_STATIC_DRAW);
+	*
+	*     glimplify::lod_selector selector(1.0f);      // at most one pixel of error
+	*     ...
+	*     selector.update(camera);                     // once per frame
+	*     object.lod = selector.select(rock.chain, object.sphere, object.lod);
+	*     const glimplify::lod_level& level = rock.chain.levels[object.lod];
+	*     glDrawElements(GL_TRIANGLES, level.index_count, indices.type, (const void*)(level.first_index * index_size));
+	*
+	*/
+
+	struct lod_level
+	{
+		GLuint first_index;
+		GLsizei index_count;
+		// geometric deviation from level 0, in object space units
+		float error;
+	};
+
+	struct lod_chain
+	{
+		std::vector<lod_level> levels;
+	};
+
+	struct lod_mesh
+	{
+		indexed_mesh mesh;
+		lod_chain chain;
+	};
+
+	/*
+	*
+	* Simplify the triangle list level after level, every level keeps about `reduction` of the previous triangles,
+	* and append all of them to lod_indices. Levels are simplified from the full mesh so their error is measured
+	* against it, the chain ends early once simplification stalls at the locked borders and seams.
+	*
+	*/
+	inline lod_chain build_lod_chain(const GLuint* indices, size_t index_count, const void* positions, size_t vertex_count, size_t stride,
+		size_t max_levels, float reduction, float max_error, std::vector<GLuint>& lod_indices, unsigned int cache_size = 16)
+	{
+		lod_chain res;
+
+		lod_level full = { static_cast<GLuint>(lod_indices.size()), static_cast<GLsizei>(index_count), 0.0f };
+		res.levels.push_back(full);
+		lod_indices.insert(lod_indices.end(), indices, indices + index_count);
+
+		size_t target = index_count;
+		for (size_t level = 1; level < max_levels; ++level)
+		{
+			target = static_cast<size_t>(target * reduction) / 3 * 3;
+
+			float error = 0.0f;
+			std::vector<GLuint> simplified = simplify(indices, index_count, positions, vertex_count, stride, target, max_error, &error);
+			if (simplified.empty() || simplified.size() * 20 >= static_cast<size_t>(res.levels.back().index_count) * 19)
+			{
+				break;
+			}
+
+			optimize_vertex_cache(simplified.data(), simplified.size(), vertex_count, cache_size);
+
+			lod_level next = { static_cast<GLuint>(lod_indices.size()), static_cast<GLsizei>(simplified.size()), error };
+			res.levels.push_back(next);
+			lod_indices.insert(lod_indices.end(), simplified.begin(), simplified.end());
+		}
+
+		return res;
+	}
+
+	// "GLOD", vertex count, stride, level count, index count, the levels, the vertex bytes, 32 bit indices
+	inline bool save_lod_mesh(const std::string& path, const lod_mesh& source)
+	{
+		std::ofstream stream(path, std::ios::out | std::ios::binary);
+		if (!stream)
+		{
+			return false;
+		}
+
+		std::uint32_t header[5] = { 0x444F4C47, static_cast<std::uint32_t>(source.mesh.vertex_count), static_cast<std::uint32_t>(source.mesh.stride),
+			static_cast<std::uint32_t>(source.chain.levels.size()), static_cast<std::uint32_t>(source.mesh.indices.size()) };
+		stream.write(reinterpret_cast<const char*>(header), sizeof(header));
+		stream.write(reinterpret_cast<const char*>(source.chain.levels.data()), source.chain.levels.size() * sizeof(lod_level));
+		stream.write(reinterpret_cast<const char*>(source.mesh.vertices.data()), source.mesh.vertices.size());
+		stream.write(reinterpret_cast<const char*>(source.mesh.indices.data()), source.mesh.indices.size() * sizeof(GLuint));
+
+		return static_cast<bool>(stream);
+	}
+
+	// fails on a header that doesn't match the file size, a level outside the indices or an index outside the vertices
+	inline bool load_lod_mesh(const std::string& path, lod_mesh& target)
+	{
+		std::ifstream stream(path, std::ios::in | std::ios::binary | std::ios::ate);
+		if (!stream)
+		{
+			return false;
+		}
+
+		std::uint64_t file_size = static_cast<std::uint64_t>(stream.tellg());
+		stream.seekg(0);
+
+		std::uint32_t header[5] = {};
+		if (!stream.read(reinterpret_cast<char*>(header), sizeof(header)) || 0x444F4C47 != header[0])
+		{
+			return false;
+		}
+
+		// in 64 bits, so counts from a broken file can't wrap around to a small size
+		std::uint64_t expected = sizeof(header) + static_cast<std::uint64_t>(header[3]) * sizeof(lod_level) +
+			static_cast<std::uint64_t>(header[1]) * header[2] + static_cast<std::uint64_t>(header[4]) * sizeof(GLuint);
+		if (expected != file_size)
+		{
+			return false;
+		}
+
+		target.mesh.vertex_count = header[1];
+		target.mesh.stride = header[2];
+		target.chain.levels.resize(header[3]);
+		target.mesh.vertices.resize(static_cast<size_t>(header[1]) * header[2]);
+		target.mesh.indices.resize(header[4]);
+
+		stream.read(reinterpret_cast<char*>(target.chain.levels.data()), target.chain.levels.size() * sizeof(lod_level));
+		stream.read(reinterpret_cast<char*>(target.mesh.vertices.data()), target.mesh.vertices.size());
+		stream.read(reinterpret_cast<char*>(target.mesh.indices.data()), target.mesh.indices.size() * sizeof(GLuint));
+		if (!stream)
+		{
+			return false;
+		}
+
+		for (const lod_level& level : target.chain.levels)
+		{
+			if (level.index_count < 0 || static_cast<std::uint64_t>(level.first_index) + static_cast<std::uint64_t>(level.index_count) > target.mesh.indices.size())
+			{
+				return false;
+			}
+		}
+
+		for (GLuint index : target.mesh.indices)
+		{
+			if (index >= target.mesh.vertex_count)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/*
+	*
+	* Picks the coarsest level whose error projects to at most `threshold` pixels. An object only coarsens once the
+	* error is below threshold * (1 - hysteresis), so one moving back and forth around a switch distance doesn't pop.
+	*
+	*/
+
+	class lod_selector
+	{
+		float _threshold;
+		float _hysteresis;
+
+		glm::vec3 _position;
+		// pixels per unit of error at distance 1
+		float _scale;
+
+		float projected(const lod_level& level, float distance) const
+		{
+			return level.error * _scale / distance;
+		}
+
+	public:
+		explicit lod_selector(float threshold, float hysteresis = 0.25f)
+			: _threshold(threshold), _hysteresis(hysteresis)
+			, _position(), _scale(0.0f)
+		{
+		}
+
+		// the camera position, vertical field of view and viewport height of this frame
+		void update(const camera& eye)
+		{
+			_position = eye.position();
+			_scale = eye.height() / (2.0f * std::tan(glm::radians(eye.fov()) * 0.5f));
+		}
+
+		// scale: how much the object is scaled from the object space of the chain
+		GLuint select(const lod_chain& chain, const bounding_sphere& sphere, GLuint current, float scale = 1.0f) const
+		{
+			if (chain.levels.empty())
+			{
+				return 0;
+			}
+
+			GLuint last = static_cast<GLuint>(chain.levels.size() - 1);
+			current = current > last ? last : current;
+
+			float distance = glm::length(sphere.center - _position) - sphere.radius;
+			if (distance <= 0.0f)
+			{
+				return 0;
+			}
+			distance /= scale;
+
+			// errors grow with the level, find the coarsest one within the threshold
+			GLuint res = 0;
+			while (res < last && projected(chain.levels[res + 1], distance) <= _threshold)
+			{
+				++res;
+			}
+
+			if (res > current)
+			{
+				// coarsen only with some margin
+				GLuint coarser = current;
+				while (coarser < res && projected(chain.levels[coarser + 1], distance) <= _threshold * (1.0f - _hysteresis))
+				{
+					++coarser;
+				}
+				res = coarser;
+			}
+
+			return res;
+		}
+
+		void threshold(float pixels)
+		{
+			_threshold = pixels;
+		}
+
+		~lod_selector()
+		{
+		}
+
+	private:
+		lod_selector() = delete;
+		lod_selector(const lod_selector&) = delete;
+		lod_selector& operator=(const lod_selector&) = delete;
+		lod_selector(lod_selector&&) = delete;
+		lod_selector&& operator=(lod_selector&&) = delete;
+	};
+};
+
+#endif
@@ -0,0 +1,104 @@
+
+#ifndef _GLIMPLIFY_MEMORY_BARRIERS_H_
+#define _GLIMPLIFY_MEMORY_BARRIERS_H_
+
+#include <glad/glad.h>
+
+namespace glimplify {
+
+	/*
+	*
+	* Incoherent writes (shader storage, images, atomic counters) are only visible to later commands after a
+	* glMemoryBarrier for the way they will be read. Instead of a full barrier after every dispatch, record what
+	* a dispatch wrote for whom and issue only the needed bits right before the consumer:
+	*
+	*     cull.dispatch_threads(object_count);
+	*     barriers.written(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+	*     ...
+	*     barriers.before(GL_COMMAND_BARRIER_BIT);        // the draw reads the commands as indirect arguments
+	*     glMultiDrawElementsIndirect(...);
+	*
+	* Consecutive writes without a reader in between are covered by a single barrier.
+	*
+	*/
+
+	class memory_barriers
+	{
+	public:
+		// the only bits glMemoryBarrierByRegion accepts
+		static const GLbitfield region_bits = GL_ATOMIC_COUNTER_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT |
+			GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT | GL_UNIFORM_BARRIER_BIT;
+
+	private:
+		GLbitfield _pending;
+		GLuint _issued;
+
+	public:
+		memory_barriers()
+			: _pending(0), _issued(0)
+		{
+		}
+
+		// a command wrote memory that is going to be read through `reads` (GL_*_BARRIER_BIT)
+		void written(GLbitfield reads)
+		{
+			_pending |= reads;
+		}
+
+		// about to read through `reads`, issues the part of the pending barrier this read depends on
+		void before(GLbitfield reads)
+		{
+			GLbitfield needed = _pending & reads;
+			if (0 != needed)
+			{
+				glMemoryBarrier(needed);
+				_pending &= ~needed;
+				++_issued;
+			}
+		}
+
+		// like before(), but only orders reads from the fragment shaders of the region of the next draw,
+		// reads through other bits than region_bits get a full barrier
+		void before_region(GLbitfield reads)
+		{
+			before(reads & ~region_bits);
+
+			GLbitfield needed = _pending & reads & region_bits;
+			if (0 != needed)
+			{
+				glMemoryBarrierByRegion(needed);
+				_pending &= ~needed;
+				++_issued;
+			}
+		}
+
+		// issue everything that is pending, e.g. at the end of a frame
+		void flush()
+		{
+			before(GL_ALL_BARRIER_BITS);
+		}
+
+		GLbitfield pending() const
+		{
+			return _pending;
+		}
+
+		// how many glMemoryBarrier calls were made, to see what the tracking saves
+		GLuint issued() const
+		{
+			return _issued;
+		}
+
+		~memory_barriers()
+		{
+		}
+
+	private:
+		memory_barriers(const memory_barriers&) = delete;
+		memory_barriers& operator=(const memory_barriers&) = delete;
+		memory_barriers(memory_barriers&&) = delete;
+		memory_barriers&& operator=(memory_barriers&&) = delete;
+	};
+};
+
+#endif
@@ -0,0 +1,329 @@
+
+#ifndef _GLIMPLIFY_MESH_H_
+#define _GLIMPLIFY_MESH_H_
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <cstring>
+
+namespace glimplify {
+
+	/*
+	*
+	* Offline style mesh processing on triangle lists, vertices are opaque blobs of `stride` bytes:
+	*
+	*     1. deduplicate  - turn an unindexed (or redundant) vertex stream into unique vertices + indices
+	*     2. optimize_vertex_cache - reorder triangles for the post-transform cache (tipsify)
+	*     3. optimize_vertex_fetch - reorder vertices in first use order so fetches walk memory linearly
+	*     4. narrow_indices - store indices as GL_UNSIGNED_SHORT whenever they fit
+	*
+	* optimize_mesh runs all of them and reports the average cache miss ratio (transformed vertices per triangle).
+	*
+	*/
+
+	struct indexed_mesh
+	{
+		std::vector<unsigned char> vertices;
+		std::vector<GLuint> indices;
+		size_t vertex_count;
+		size_t stride;
+	};
+
+	struct index_buffer
+	{
+		GLenum type;
+		GLsizei count;
+		std::vector<unsigned char> data;
+	};
+
+	struct mesh_report
+	{
+		size_t vertices_before;
+		size_t vertices_after;
+		// acmr of the deduplicated mesh in its original triangle order, an unindexed mesh is always 3
+		float acmr_before;
+		float acmr_after;
+		size_t index_bytes;
+	};
+
+	inline indexed_mesh deduplicate(const void* vertices, size_t count, size_t stride)
+	{
+		indexed_mesh res;
+		res.vertex_count = 0;
+		res.stride = stride;
+		res.indices.resize(count);
+		res.vertices.reserve(count * stride);
+
+		const unsigned char* src = static_cast<const unsigned char*>(vertices);
+
+		// open addressing table of unique vertex indices, at most half full
+		size_t buckets = 1;
+		while (buckets < count * 2)
+		{
+			buckets <<= 1;
+		}
+		std::vector<GLuint> table(buckets, 0xFFFFFFFF);
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const unsigned char* vertex = src + i * stride;
+
+			// fnv-1a over the vertex bytes
+			size_t hash = 2166136261u;
+			for (size_t b = 0; b < stride; ++b)
+			{
+				hash = (hash ^ vertex[b]) * 16777619u;
+			}
+
+			size_t bucket = hash & (buckets - 1);
+			while (0xFFFFFFFF != table[bucket] && 0 != memcmp(&res.vertices[table[bucket] * stride], vertex, stride))
+			{
+				bucket = (bucket + 1) & (buckets - 1);
+			}
+
+			if (0xFFFFFFFF == table[bucket])
+			{
+				table[bucket] = static_cast<GLuint>(res.vertex_count++);
+				res.vertices.insert(res.vertices.end(), vertex, vertex + stride);
+			}
+
+			res.indices[i] = table[bucket];
+		}
+
+		return res;
+	}
+
+	// average cache miss ratio of a fifo post-transform cache, transformed vertices per triangle
+	inline float acmr(const GLuint* indices, size_t index_count, size_t vertex_count, unsigned int cache_size = 16)
+	{
+		if (index_count < 3)
+		{
+			return 0.0f;
+		}
+
+		std::vector<size_t> timestamps(vertex_count, 0);
+		size_t time = cache_size + 1;
+		size_t misses = 0;
+
+		for (size_t i = 0; i < index_count; ++i)
+		{
+			GLuint index = indices[i];
+			if (time - timestamps[index] > cache_size)
+			{
+				timestamps[index] = time++;
+				++misses;
+			}
+		}
+
+		return static_cast<float>(misses) / static_cast<float>(index_count / 3);
+	}
+
+	/*
+	*
+	* Tipsify, Sander, Nehab and Barczak 2007, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw".
+	* Fans around a vertex, then moves on to the adjacent vertex that is still in cache and has the fewest live triangles.
+	*
+	*/
+	inline void optimize_vertex_cache(GLuint* indices, size_t index_count, size_t vertex_count, unsigned int cache_size = 16)
+	{
+		size_t triangle_count = index_count / 3;
+		if (triangle_count < 2)
+		{
+			return;
+		}
+
+		// vertex -> triangles adjacency in one flat array
+		std::vector<GLuint> live(vertex_count, 0);
+		for (size_t i = 0; i < triangle_count * 3; ++i)
+		{
+			++live[indices[i]];
+		}
+
+		std::vector<GLuint> offsets(vertex_count + 1, 0);
+		for (size_t v = 0; v < vertex_count; ++v)
+		{
+			offsets[v + 1] = offsets[v] + live[v];
+		}
+
+		std::vector<GLuint> adjacency(triangle_count * 3);
+		std::vector<GLuint> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t t = 0; t < triangle_count; ++t)
+		{
+			for (size_t c = 0; c < 3; ++c)
+			{
+				adjacency[fill[indices[t * 3 + c]]++] = static_cast<GLuint>(t);
+			}
+		}
+
+		std::vector<size_t> timestamps(vertex_count, 0);
+		size_t time = cache_size + 1;
+
+		std::vector<bool> emitted(triangle_count, false);
+		std::vector<GLuint> dead_end;
+		std::vector<GLuint> candidates;
+		std::vector<GLuint> output;
+		output.reserve(triangle_count * 3);
+
+		size_t cursor = 0;
+		long long fanning = 0;
+
+		while (fanning >= 0)
+		{
+			candidates.clear();
+
+			GLuint vertex = static_cast<GLuint>(fanning);
+			for (GLuint a = offsets[vertex]; a < offsets[vertex + 1]; ++a)
+			{
+				GLuint triangle = adjacency[a];
+				if (emitted[triangle])
+				{
+					continue;
+				}
+
+				for (size_t c = 0; c < 3; ++c)
+				{
+					GLuint v = indices[triangle * 3 + c];
+					output.push_back(v);
+					dead_end.push_back(v);
+					candidates.push_back(v);
+					--live[v];
+
+					if (time - timestamps[v] > cache_size)
+					{
+						timestamps[v] = time++;
+					}
+				}
+
+				emitted[triangle] = true;
+			}
+
+			// prefer a candidate that stays in cache while its remaining fan is emitted
+			fanning = -1;
+			long long priority = -1;
+			for (GLuint v : candidates)
+			{
+				if (live[v] > 0)
+				{
+					long long p = 0;
+					if (time - timestamps[v] + 2 * live[v] <= cache_size)
+					{
+						p = static_cast<long long>(time - timestamps[v]);
+					}
+
+					if (p > priority)
+					{
+						priority = p;
+						fanning = v;
+					}
+				}
+			}
+
+			if (fanning < 0)
+			{
+				// dead end, back up through recently used vertices, then scan for any vertex with triangles left
+				while (!dead_end.empty() && fanning < 0)
+				{
+					GLuint v = dead_end.back();
+					dead_end.pop_back();
+					if (live[v] > 0)
+					{
+						fanning = v;
+					}
+				}
+
+				while (cursor < vertex_count && fanning < 0)
+				{
+					if (live[cursor] > 0)
+					{
+						fanning = static_cast<long long>(cursor);
+					}
+					++cursor;
+				}
+			}
+		}
+
+		memcpy(indices, output.data(), output.size() * sizeof(GLuint));
+	}
+
+	// reorder vertices by first use and drop unreferenced ones, returns the new vertex count
+	inline size_t optimize_vertex_fetch(GLuint* indices, size_t index_count, unsigned char* vertices, size_t vertex_count, size_t stride)
+	{
+		std::vector<GLuint> remap(vertex_count, 0xFFFFFFFF);
+		std::vector<unsigned char> reordered;
+		reordered.reserve(vertex_count * stride);
+
+		GLuint next = 0;
+		for (size_t i = 0; i < index_count; ++i)
+		{
+			GLuint& index = remap[indices[i]];
+			if (0xFFFFFFFF == index)
+			{
+				index = next++;
+				reordered.insert(reordered.end(), vertices + indices[i] * stride, vertices + (indices[i] + 1) * stride);
+			}
+			indices[i] = index;
+		}
+
+		memcpy(vertices, reordered.data(), reordered.size());
+
+		return next;
+	}
+
+	inline index_buffer narrow_indices(const GLuint* indices, size_t index_count)
+	{
+		GLuint largest = 0;
+		for (size_t i = 0; i < index_count; ++i)
+		{
+			largest = indices[i] > largest ? indices[i] : largest;
+		}
+
+		index_buffer res;
+		res.count = static_cast<GLsizei>(index_count);
+
+		if (largest <= 0xFFFF)
+		{
+			res.type = GL_UNSIGNED_SHORT;
+			res.data.resize(index_count * sizeof(GLushort));
+
+			GLushort* narrowed = reinterpret_cast<GLushort*>(res.data.data());
+			for (size_t i = 0; i < index_count; ++i)
+			{
+				narrowed[i] = static_cast<GLushort>(indices[i]);
+			}
+		}
+		else
+		{
+			res.type = GL_UNSIGNED_INT;
+			res.data.resize(index_count * sizeof(GLuint));
+			memcpy(res.data.data(), indices, res.data.size());
+		}
+
+		return res;
+	}
+
+	// deduplicate an unindexed triangle list and run the whole optimization chain on it
+	inline indexed_mesh optimize_mesh(const void* vertices, size_t count, size_t stride, mesh_report* report = nullptr, unsigned int cache_size = 16)
+	{
+		indexed_mesh res = deduplicate(vertices, count, stride);
+
+		float acmr_before = acmr(res.indices.data(), res.indices.size(), res.vertex_count, cache_size);
+
+		optimize_vertex_cache(res.indices.data(), res.indices.size(), res.vertex_count, cache_size);
+		res.vertex_count = optimize_vertex_fetch(res.indices.data(), res.indices.size(), res.vertices.data(), res.vertex_count, stride);
+		res.vertices.resize(res.vertex_count * stride);
+
+		if (report)
+		{
+			report->vertices_before = count;
+			report->vertices_after = res.vertex_count;
+			report->acmr_before = acmr_before;
+			report->acmr_after = acmr(res.indices.data(), res.indices.size(), res.vertex_count, cache_size);
+			report->index_bytes = res.indices.size() * (res.vertex_count <= 0x10000 ? sizeof(GLushort) : sizeof(GLuint));
+		}
+
+		return res;
+	}
+};
+
+#endif
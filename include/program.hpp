@@ -1,145 +1,716 @@
-
-#ifndef _GLIMPLIFY_PROGRAM_H_
-#define _GLIMPLIFY_PROGRAM_H_
-
-#include "size_of.hpp"
-
-#include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
-
-#include <unordered_map>
-
-namespace glimplify {
-
-	class program
-	{
-		class shader
-		{
-			GLenum _type;
-			GLuint _id;
-
-		public:
-			explicit shader(GLenum type, const char* source)
-				: _type(type), _id(glCreateShader(type))
-			{
-				glShaderSource(_id, 1, &source, NULL);
-				glCompileShader(_id);
-			}
-
-			bool check(GLsizei length, GLchar* desc)
-			{
-				// check for shader compile errors
-				int status = 0;
-				glGetShaderiv(_id, GL_COMPILE_STATUS, &status);
-				if (0 == status)
-				{
-					glGetShaderInfoLog(_id, length, NULL, desc);
-				}
-				return 0 != status;
-			}
-
-			~shader()
-			{
-				glDeleteShader(_id);
-			}
-
-			friend class program;
-
-		private:
-			shader() = delete;
-			shader(const shader&) = delete;
-			shader& operator=(const shader&) = delete;
-			shader(shader&&) = delete;
-			shader&& operator=(shader&&) = delete;
-		};
-
-		using uniform_name_loactions = std::unordered_map<std::string, GLint>;
-
-		GLuint _id;
-		uniform_name_loactions _uniform_name_loactions;
-
-		GLint uniform_location(const char* name)
-		{
-			GLint location = -1;
-			uniform_name_loactions::iterator name_location = _uniform_name_loactions.find(name);
-			if (_uniform_name_loactions.end() != name_location)
-			{
-				location = name_location->second;
-			}
-			else
-			{
-				location = glGetUniformLocation(_id, name);
-
-				_uniform_name_loactions.insert(std::make_pair(name, location));
-			}
-
-			return location;
-		}
-
-	public:
-		program()
-			: _id(glCreateProgram())
-		{
-		}
-
-		bool compile(const char* vertex_shader_source, const char* fragment_shader_source, GLsizei length, GLchar* desc)
-		{
-			shader vertex_shader(GL_VERTEX_SHADER, vertex_shader_source);
-			shader fragment_shader(GL_FRAGMENT_SHADER, fragment_shader_source);
-
-			bool res = vertex_shader.check(length, desc) && fragment_shader.check(length, desc);
-
-			if (res)
-			{
-				glAttachShader(_id, vertex_shader._id);
-				glAttachShader(_id, fragment_shader._id);
-				glLinkProgram(_id);
-
-				int status = 0;
-				glGetProgramiv(_id, GL_LINK_STATUS, &status);
-				if (0 == status) 
-				{
-					glGetProgramInfoLog(_id, length, NULL, desc);
-				}
-
-				res = (0 != status);
-			}
-
-			return res;
-		}
-
-		void bind()
-		{
-			glUseProgram(_id);
-		}
-
-		void set_uniform_1i(const char* name, GLint value)
-		{
-			glUniform1i(uniform_location(name), value);
-		}
-
-		void set_uniform_matrix4fv(const char* name, const glm::mat4& value)
-		{
-			glUniformMatrix4fv(uniform_location(name), 1, GL_FALSE, glm::value_ptr(value));
-		}
-
-		void unbind()
-		{
-			glUseProgram(0);
-		}
-
-		~program()
-		{
-			glDeleteProgram(_id);
-		}
-
-	private:
-		program(const program&) = delete;
-		program& operator=(const program&) = delete;
-		program(program&&) = delete;
-		program&& operator=(program&&) = delete;
-	};
-};
-
-#endif
+
+#ifndef _GLIMPLIFY_PROGRAM_H_
+#define _GLIMPLIFY_PROGRAM_H_
+
+#include "buffer.hpp"
+#include "program_reflection.hpp"
+#include "simd.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace glimplify {
+
+	class program
+	{
+		class shader
+		{
+			GLenum _type;
+			GLuint _id;
+
+		public:
+			explicit shader(GLenum type, const char* source)
+				: _type(type), _id(glCreateShader(type))
+			{
+				glShaderSource(_id, 1, &source, NULL);
+				glCompileShader(_id);
+			}
+
+			bool check(GLsizei length, GLchar* desc)
+			{
+				// check for shader compile errors
+				int status = 0;
+				glGetShaderiv(_id, GL_COMPILE_STATUS, &status);
+				// gl writes nothing when there is no log, the caller still gets a terminated string
+				if (0 == status && length > 0)
+				{
+					desc[0] = 0;
+					glGetShaderInfoLog(_id, length, NULL, desc);
+				}
+				return 0 != status;
+			}
+
+			~shader()
+			{
+				glDeleteShader(_id);
+			}
+
+			friend class program;
+
+		private:
+			shader() = delete;
+			shader(const shader&) = delete;
+			shader& operator=(const shader&) = delete;
+			shader(shader&&) = delete;
+			shader&& operator=(shader&&) = delete;
+		};
+
+		// glProgramUniform* when available, otherwise the program has to be bound before setting uniforms
+		bool _program_uniform;
+		// GL_COMPLETION_STATUS_KHR can be polled without waiting for the compiler
+		bool _parallel_compile;
+		bool _compute_shader;
+		// why the last submit wasn't handed to the driver at all, reported by resolve()
+		const char* _error;
+
+		GLuint _id;
+		// GL_*_SHADER_BIT of the linked stages, what a program_pipeline takes from this program
+		GLbitfield _stages;
+		bool _separable;
+		// local_size_x/y/z of a linked compute program
+		GLint _work_group_size[3];
+		// read right after a successful link, every uniform location is known before the first set
+		program_reflection _reflection;
+
+		// shaders of a submitted link, kept until resolve() for their compile logs
+		std::vector<std::unique_ptr<shader>> _shaders;
+
+		// the last value uploaded to every default block uniform location, 4 bytes per component,
+		// uniforms are only uploaded when the new value differs
+		std::vector<GLuint> _shadow;
+		std::vector<GLuint> _shadow_offsets;
+		std::vector<bool> _shadow_valid;
+
+		void reset()
+		{
+			// a submit that was never resolved still has its stages attached, they would be linked again
+			detach();
+			_error = nullptr;
+			_reflection.clear();
+			_work_group_size[0] = _work_group_size[1] = _work_group_size[2] = 0;
+			build_shadow();
+		}
+
+		void detach()
+		{
+			for (const std::unique_ptr<shader>& stage : _shaders)
+			{
+				glDetachShader(_id, stage->_id);
+			}
+			_shaders.clear();
+		}
+
+		void link(bool separable)
+		{
+			// the parameter sticks to the program object, a later monolithic link has to clear it again
+			if (separable != _separable)
+			{
+				glProgramParameteri(_id, GL_PROGRAM_SEPARABLE, separable ? GL_TRUE : GL_FALSE);
+				_separable = separable;
+			}
+
+			_stages = 0;
+			for (const std::unique_ptr<shader>& stage : _shaders)
+			{
+				_stages |= stage_bit(stage->_type);
+				glAttachShader(_id, stage->_id);
+			}
+			glLinkProgram(_id);
+		}
+
+		static GLbitfield stage_bit(GLenum type)
+		{
+			switch (type)
+			{
+			case GL_VERTEX_SHADER: return GL_VERTEX_SHADER_BIT;
+			case GL_TESS_CONTROL_SHADER: return GL_TESS_CONTROL_SHADER_BIT;
+			case GL_TESS_EVALUATION_SHADER: return GL_TESS_EVALUATION_SHADER_BIT;
+			case GL_GEOMETRY_SHADER: return GL_GEOMETRY_SHADER_BIT;
+			case GL_FRAGMENT_SHADER: return GL_FRAGMENT_SHADER_BIT;
+			case GL_COMPUTE_SHADER: return GL_COMPUTE_SHADER_BIT;
+			default: return 0;
+			}
+		}
+
+		// lay out the shadow values for the uniforms of the last link, nothing is known about their values yet
+		void build_shadow()
+		{
+			_shadow.clear();
+			_shadow_offsets.clear();
+			_shadow_valid.clear();
+
+			for (const program_resource& uniform : _reflection.uniforms())
+			{
+				GLint components = 0;
+				GLenum kind = 0;
+				uniform_format(uniform.type, components, kind);
+
+				// the elements of an array are consecutive in the shadow whatever their locations, so a whole array compares as one range
+				for (GLint element = 0; element < uniform.size && components > 0; ++element)
+				{
+					size_t location = static_cast<size_t>(uniform.locations[element]);
+					if (_shadow_offsets.size() <= location)
+					{
+						_shadow_offsets.resize(location + 1, 0xFFFFFFFF);
+						_shadow_valid.resize(location + 1, false);
+					}
+
+					_shadow_offsets[location] = static_cast<GLuint>(_shadow.size());
+					_shadow.resize(_shadow.size() + components, 0);
+				}
+			}
+		}
+
+		static bool same_words(const GLuint* shadow, const void* data, size_t words)
+		{
+			const unsigned char* bytes = static_cast<const unsigned char*>(data);
+			size_t i = 0;
+#ifdef GLIMPLIFY_SSE2
+			// bitwise, so -0.0 and nan changes are uploaded too, a mat4 is 4 compares
+			for (; i + 4 <= words; i += 4)
+			{
+				__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(shadow + i));
+				__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i * sizeof(GLuint)));
+				if (0xFFFF != _mm_movemask_epi8(_mm_cmpeq_epi32(a, b)))
+				{
+					return false;
+				}
+			}
+#endif
+			return 0 == memcmp(shadow + i, bytes + i * sizeof(GLuint), (words - i) * sizeof(GLuint));
+		}
+
+		// true when `count` elements of uniform starting at first differ from the shadow, which then holds them
+		bool changed(const program_resource& uniform, GLint first, GLint components, GLsizei count, const void* data)
+		{
+			bool valid = true;
+			for (GLsizei element = 0; element < count; ++element)
+			{
+				valid = valid && _shadow_valid[uniform.locations[first + element]];
+			}
+
+			GLuint* shadow = _shadow.data() + _shadow_offsets[uniform.locations[first]];
+			size_t words = static_cast<size_t>(components) * count;
+			if (valid && same_words(shadow, data, words))
+			{
+				return false;
+			}
+
+			memcpy(shadow, data, words * sizeof(GLuint));
+			for (GLsizei element = 0; element < count; ++element)
+			{
+				_shadow_valid[uniform.locations[first + element]] = true;
+			}
+
+			return true;
+		}
+
+		/*
+		*
+		* Set `count` elements of uniform `name` ("name" or "name[i]") from values of `components` x `kind`.
+		* Inactive uniforms are silently ignored like with glGetUniformLocation, a uniform of another type reports
+		* a debug message, unchanged values are not uploaded.
+		*
+		*/
+		void set(const char* name, GLint components, GLenum kind, GLsizei count, const void* data)
+		{
+			GLint element = 0;
+			const program_resource* resource = _reflection.uniform(name, element);
+			if (!resource)
+			{
+				return;
+			}
+
+			GLint resource_components = 0;
+			GLenum resource_kind = 0;
+			uniform_format(resource->type, resource_components, resource_kind);
+			if (resource_components != components || resource_kind != kind)
+			{
+				std::string message = std::string("uniform ") + name + " is set with a value of the wrong type";
+				glDebugMessageInsert(GL_DEBUG_SOURCE_APPLICATION, GL_DEBUG_TYPE_ERROR, 0, GL_DEBUG_SEVERITY_HIGH, -1, message.c_str());
+				return;
+			}
+
+			// gl ignores the elements past the end of the array as well
+			count = std::min(count, resource->size - element);
+
+			// gl loads `count` elements from the location of the first one, however the elements are numbered
+			if (count > 0 && changed(*resource, element, components, count, data))
+			{
+				upload(resource->locations[element], components, kind, count, data);
+			}
+		}
+
+		// how a default block uniform type is read and written, 0 components for the types without a setter (doubles, atomic counters)
+		static void uniform_format(GLenum type, GLint& components, GLenum& kind)
+		{
+			components = 1;
+			kind = GL_INT;
+
+			switch (type)
+			{
+			case GL_FLOAT: kind = GL_FLOAT; break;
+			case GL_FLOAT_VEC2: kind = GL_FLOAT; components = 2; break;
+			case GL_FLOAT_VEC3: kind = GL_FLOAT; components = 3; break;
+			case GL_FLOAT_VEC4: kind = GL_FLOAT; components = 4; break;
+			case GL_FLOAT_MAT2: kind = GL_FLOAT_MAT2; components = 4; break;
+			case GL_FLOAT_MAT3: kind = GL_FLOAT_MAT3; components = 9; break;
+			case GL_FLOAT_MAT4: kind = GL_FLOAT_MAT4; components = 16; break;
+			case GL_FLOAT_MAT2x3: kind = GL_FLOAT_MAT2x3; components = 6; break;
+			case GL_FLOAT_MAT2x4: kind = GL_FLOAT_MAT2x4; components = 8; break;
+			case GL_FLOAT_MAT3x2: kind = GL_FLOAT_MAT3x2; components = 6; break;
+			case GL_FLOAT_MAT3x4: kind = GL_FLOAT_MAT3x4; components = 12; break;
+			case GL_FLOAT_MAT4x2: kind = GL_FLOAT_MAT4x2; components = 8; break;
+			case GL_FLOAT_MAT4x3: kind = GL_FLOAT_MAT4x3; components = 12; break;
+			case GL_INT_VEC2: case GL_BOOL_VEC2: components = 2; break;
+			case GL_INT_VEC3: case GL_BOOL_VEC3: components = 3; break;
+			case GL_INT_VEC4: case GL_BOOL_VEC4: components = 4; break;
+			case GL_UNSIGNED_INT: kind = GL_UNSIGNED_INT; break;
+			case GL_UNSIGNED_INT_VEC2: kind = GL_UNSIGNED_INT; components = 2; break;
+			case GL_UNSIGNED_INT_VEC3: kind = GL_UNSIGNED_INT; components = 3; break;
+			case GL_UNSIGNED_INT_VEC4: kind = GL_UNSIGNED_INT; components = 4; break;
+			case GL_DOUBLE: case GL_DOUBLE_VEC2: case GL_DOUBLE_VEC3: case GL_DOUBLE_VEC4:
+			case GL_DOUBLE_MAT2: case GL_DOUBLE_MAT3: case GL_DOUBLE_MAT4:
+			case GL_DOUBLE_MAT2x3: case GL_DOUBLE_MAT2x4: case GL_DOUBLE_MAT3x2:
+			case GL_DOUBLE_MAT3x4: case GL_DOUBLE_MAT4x2: case GL_DOUBLE_MAT4x3:
+			case GL_UNSIGNED_INT_ATOMIC_COUNTER:
+				components = 0; break;
+			default:
+				// int, bool, samplers and images are all set as one int
+				break;
+			}
+		}
+
+		// write uniform values of this program, it must be bound already without glProgramUniform*
+		void upload(GLint location, GLint components, GLenum kind, GLsizei count, const void* data)
+		{
+			const GLfloat* f = static_cast<const GLfloat*>(data);
+			const GLint* i = static_cast<const GLint*>(data);
+			const GLuint* u = static_cast<const GLuint*>(data);
+
+			switch (kind)
+			{
+			case GL_FLOAT:
+				switch (components)
+				{
+				case 1: _program_uniform ? glProgramUniform1fv(_id, location, count, f) : glUniform1fv(location, count, f); break;
+				case 2: _program_uniform ? glProgramUniform2fv(_id, location, count, f) : glUniform2fv(location, count, f); break;
+				case 3: _program_uniform ? glProgramUniform3fv(_id, location, count, f) : glUniform3fv(location, count, f); break;
+				default: _program_uniform ? glProgramUniform4fv(_id, location, count, f) : glUniform4fv(location, count, f); break;
+				}
+				break;
+			case GL_INT:
+				switch (components)
+				{
+				case 1: _program_uniform ? glProgramUniform1iv(_id, location, count, i) : glUniform1iv(location, count, i); break;
+				case 2: _program_uniform ? glProgramUniform2iv(_id, location, count, i) : glUniform2iv(location, count, i); break;
+				case 3: _program_uniform ? glProgramUniform3iv(_id, location, count, i) : glUniform3iv(location, count, i); break;
+				default: _program_uniform ? glProgramUniform4iv(_id, location, count, i) : glUniform4iv(location, count, i); break;
+				}
+				break;
+			case GL_UNSIGNED_INT:
+				switch (components)
+				{
+				case 1: _program_uniform ? glProgramUniform1uiv(_id, location, count, u) : glUniform1uiv(location, count, u); break;
+				case 2: _program_uniform ? glProgramUniform2uiv(_id, location, count, u) : glUniform2uiv(location, count, u); break;
+				case 3: _program_uniform ? glProgramUniform3uiv(_id, location, count, u) : glUniform3uiv(location, count, u); break;
+				default: _program_uniform ? glProgramUniform4uiv(_id, location, count, u) : glUniform4uiv(location, count, u); break;
+				}
+				break;
+			case GL_FLOAT_MAT2: _program_uniform ? glProgramUniformMatrix2fv(_id, location, count, GL_FALSE, f) : glUniformMatrix2fv(location, count, GL_FALSE, f); break;
+			case GL_FLOAT_MAT3: _program_uniform ? glProgramUniformMatrix3fv(_id, location, count, GL_FALSE, f) : glUniformMatrix3fv(location, count, GL_FALSE, f); break;
+			case GL_FLOAT_MAT4: _program_uniform ? glProgramUniformMatrix4fv(_id, location, count, GL_FALSE, f) : glUniformMatrix4fv(location, count, GL_FALSE, f); break;
+			case GL_FLOAT_MAT2x3: _program_uniform ? glProgramUniformMatrix2x3fv(_id, location, count, GL_FALSE, f) : glUniformMatrix2x3fv(location, count, GL_FALSE, f); break;
+			case GL_FLOAT_MAT2x4: _program_uniform ? glProgramUniformMatrix2x4fv(_id, location, count, GL_FALSE, f) : glUniformMatrix2x4fv(location, count, GL_FALSE, f); break;
+			case GL_FLOAT_MAT3x2: _program_uniform ? glProgramUniformMatrix3x2fv(_id, location, count, GL_FALSE, f) : glUniformMatrix3x2fv(location, count, GL_FALSE, f); break;
+			case GL_FLOAT_MAT3x4: _program_uniform ? glProgramUniformMatrix3x4fv(_id, location, count, GL_FALSE, f) : glUniformMatrix3x4fv(location, count, GL_FALSE, f); break;
+			case GL_FLOAT_MAT4x2: _program_uniform ? glProgramUniformMatrix4x2fv(_id, location, count, GL_FALSE, f) : glUniformMatrix4x2fv(location, count, GL_FALSE, f); break;
+			case GL_FLOAT_MAT4x3: _program_uniform ? glProgramUniformMatrix4x3fv(_id, location, count, GL_FALSE, f) : glUniformMatrix4x3fv(location, count, GL_FALSE, f); break;
+			default: break;
+			}
+		}
+
+	public:
+		program()
+			: _program_uniform(capabilities::current().program_uniform())
+			, _parallel_compile(capabilities::current().parallel_shader_compile())
+			, _compute_shader(capabilities::current().compute_shader())
+			, _error(nullptr)
+			, _id(glCreateProgram())
+			, _stages(0), _separable(false)
+		{
+			_work_group_size[0] = _work_group_size[1] = _work_group_size[2] = 0;
+		}
+
+		bool compile(const char* vertex_shader_source, const char* fragment_shader_source, GLsizei length, GLchar* desc)
+		{
+			submit(vertex_shader_source, fragment_shader_source);
+			return resolve(length, desc);
+		}
+
+		/*
+		*
+		* Asynchronous compile: submit() hands the sources to the driver and links without asking for any status,
+		* ready() polls without blocking (always true without KHR_parallel_shader_compile),
+		* resolve() reads the status and logs, waiting for the driver if it is not done yet.
+		*
+		*/
+		void submit(const char* vertex_shader_source, const char* fragment_shader_source)
+		{
+			reset();
+
+			_shaders.emplace_back(new shader(GL_VERTEX_SHADER, vertex_shader_source));
+			_shaders.emplace_back(new shader(GL_FRAGMENT_SHADER, fragment_shader_source));
+
+			link(false);
+		}
+
+		/*
+		*
+		* Separable single stage program (GL_PROGRAM_SEPARABLE), combined with programs of other stages by a
+		* program_pipeline at bind time, so N vertex and M fragment variants are N + M links instead of N * M.
+		* Needs capabilities::separate_shader_objects(). Resolve with ready()/resolve() like submit().
+		*
+		*/
+		void submit_stage(GLenum type, const char* source)
+		{
+			reset();
+
+			_shaders.emplace_back(new shader(type, source));
+
+			link(true);
+		}
+
+		bool compile_stage(GLenum type, const char* source, GLsizei length, GLchar* desc)
+		{
+			submit_stage(type, source);
+			return resolve(length, desc);
+		}
+
+		// compute program, dispatched with dispatch*() while bound. Needs capabilities::compute_shader(), resolve() fails without
+		void submit_compute(const char* compute_shader_source)
+		{
+			reset();
+
+			if (!_compute_shader)
+			{
+				_error = "compute shaders need gl 4.3 or GL_ARB_compute_shader";
+				return;
+			}
+
+			_shaders.emplace_back(new shader(GL_COMPUTE_SHADER, compute_shader_source));
+
+			link(false);
+		}
+
+		bool compile_compute(const char* compute_shader_source, GLsizei length, GLchar* desc)
+		{
+			submit_compute(compute_shader_source);
+			return resolve(length, desc);
+		}
+
+		bool ready() const
+		{
+			if (_shaders.empty() || !_parallel_compile)
+			{
+				return true;
+			}
+
+			int status = 0;
+			glGetProgramiv(_id, GL_COMPLETION_STATUS_KHR, &status);
+			return 0 != status;
+		}
+
+		bool resolve(GLsizei length, GLchar* desc)
+		{
+			if (_error)
+			{
+				snprintf(desc, length, "%s", _error);
+				_error = nullptr;
+				return false;
+			}
+
+			bool res = true;
+			for (const std::unique_ptr<shader>& stage : _shaders)
+			{
+				res = res && stage->check(length, desc);
+			}
+
+			if (res)
+			{
+				int status = 0;
+				glGetProgramiv(_id, GL_LINK_STATUS, &status);
+				if (0 == status && length > 0)
+				{
+					desc[0] = 0;
+					glGetProgramInfoLog(_id, length, NULL, desc);
+				}
+
+				res = (0 != status);
+			}
+
+			if (res)
+			{
+				_reflection.build(_id);
+				build_shadow();
+
+				if (0 != (_stages & GL_COMPUTE_SHADER_BIT))
+				{
+					glGetProgramiv(_id, GL_COMPUTE_WORK_GROUP_SIZE, _work_group_size);
+				}
+			}
+
+			// the linked program doesn't need the shader objects anymore
+			detach();
+
+			return res;
+		}
+
+		GLuint id() const
+		{
+			return _id;
+		}
+
+		// the GL_*_SHADER_BIT stages of the last link, 0 before any
+		GLbitfield stages() const
+		{
+			return _stages;
+		}
+
+		bool separable() const
+		{
+			return _separable;
+		}
+
+		// exchange the gl programs, objects holding a reference to this program draw with the other one from now on
+		void swap(program& other)
+		{
+			std::swap(_id, other._id);
+			std::swap(_stages, other._stages);
+			std::swap(_separable, other._separable);
+			std::swap(_work_group_size, other._work_group_size);
+			_reflection.swap(other._reflection);
+			// the shadow values belong to the gl program they were uploaded to
+			_shadow.swap(other._shadow);
+			_shadow_offsets.swap(other._shadow_offsets);
+			_shadow_valid.swap(other._shadow_valid);
+			_shaders.swap(other._shaders);
+		}
+
+		/*
+		*
+		* Copy the default block uniform values of another program into the ones with the same name here,
+		* so a relinked program keeps what was set on the old one. Uniforms missing on either side are skipped.
+		*
+		*/
+		void copy_uniforms(const program& from)
+		{
+			GLint current = 0;
+			if (!_program_uniform)
+			{
+				glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+				glUseProgram(_id);
+			}
+
+			for (const program_resource& uniform : from._reflection.uniforms())
+			{
+				GLint components = 0;
+				GLenum kind = 0;
+				uniform_format(uniform.type, components, kind);
+
+				GLint first = 0;
+				const program_resource* target = _reflection.uniform(uniform.name.c_str(), first);
+				if (0 == components || !target || target->type != uniform.type)
+				{
+					continue;
+				}
+
+				for (GLint element = 0; element < uniform.size && element < target->size; ++element)
+				{
+					// 16 words fit every non double type, the shadow of the copy is filled like any other set
+					GLuint value[16] = { 0 };
+					switch (kind)
+					{
+					case GL_INT: glGetUniformiv(from._id, uniform.locations[element], reinterpret_cast<GLint*>(value)); break;
+					case GL_UNSIGNED_INT: glGetUniformuiv(from._id, uniform.locations[element], value); break;
+					default: glGetUniformfv(from._id, uniform.locations[element], reinterpret_cast<GLfloat*>(value)); break;
+					}
+
+					if (changed(*target, element, components, 1, value))
+					{
+						upload(target->locations[element], components, kind, 1, value);
+					}
+				}
+			}
+
+			if (!_program_uniform)
+			{
+				glUseProgram(current);
+			}
+		}
+
+		// the uniforms, vertex inputs and blocks of the last successful link
+		const program_reflection& reflection() const
+		{
+			return _reflection;
+		}
+
+		void bind()
+		{
+			glUseProgram(_id);
+		}
+
+		// local size of the compute shader in x, y, z
+		GLint work_group_size(int axis) const
+		{
+			return _work_group_size[axis];
+		}
+
+		// run work groups of the bound compute program
+		void dispatch(GLuint groups_x, GLuint groups_y = 1, GLuint groups_z = 1)
+		{
+			glDispatchCompute(groups_x, groups_y, groups_z);
+		}
+
+		// run at least the given number of invocations, rounded up to whole work groups, nothing without a linked compute shader
+		void dispatch_threads(GLuint threads_x, GLuint threads_y = 1, GLuint threads_z = 1)
+		{
+			if (0 == (_stages & GL_COMPUTE_SHADER_BIT) || _work_group_size[0] <= 0 || _work_group_size[1] <= 0 || _work_group_size[2] <= 0)
+			{
+				return;
+			}
+
+			GLuint x = static_cast<GLuint>(_work_group_size[0]), y = static_cast<GLuint>(_work_group_size[1]), z = static_cast<GLuint>(_work_group_size[2]);
+			glDispatchCompute((threads_x + x - 1) / x, (threads_y + y - 1) / y, (threads_z + z - 1) / z);
+		}
+
+		// the group counts are read from three GLuint at offset of arguments, e.g. written by an earlier dispatch
+		void dispatch_indirect(buffer& arguments, GLintptr offset = 0)
+		{
+			arguments.bind(GL_DISPATCH_INDIRECT_BUFFER);
+			glDispatchComputeIndirect(offset);
+		}
+
+		void set_uniform_1i(const char* name, GLint value)
+		{
+			set(name, 1, GL_INT, 1, &value);
+		}
+
+		void set_uniform_1ui(const char* name, GLuint value)
+		{
+			set(name, 1, GL_UNSIGNED_INT, 1, &value);
+		}
+
+		void set_uniform_1f(const char* name, GLfloat value)
+		{
+			set(name, 1, GL_FLOAT, 1, &value);
+		}
+
+		void set_uniform_2fv(const char* name, const glm::vec2& value)
+		{
+			set(name, 2, GL_FLOAT, 1, glm::value_ptr(value));
+		}
+
+		void set_uniform_3fv(const char* name, const glm::vec3& value)
+		{
+			set(name, 3, GL_FLOAT, 1, glm::value_ptr(value));
+		}
+
+		void set_uniform_4fv(const char* name, const glm::vec4& value)
+		{
+			set(name, 4, GL_FLOAT, 1, glm::value_ptr(value));
+		}
+
+		void set_uniform_2iv(const char* name, const glm::ivec2& value)
+		{
+			set(name, 2, GL_INT, 1, glm::value_ptr(value));
+		}
+
+		void set_uniform_3iv(const char* name, const glm::ivec3& value)
+		{
+			set(name, 3, GL_INT, 1, glm::value_ptr(value));
+		}
+
+		void set_uniform_4iv(const char* name, const glm::ivec4& value)
+		{
+			set(name, 4, GL_INT, 1, glm::value_ptr(value));
+		}
+
+		void set_uniform_matrix3fv(const char* name, const glm::mat3& value)
+		{
+			set(name, 9, GL_FLOAT_MAT3, 1, glm::value_ptr(value));
+		}
+
+		void set_uniform_matrix4fv(const char* name, const glm::mat4& value)
+		{
+			set(name, 16, GL_FLOAT_MAT4, 1, glm::value_ptr(value));
+		}
+
+		// arrays, `count` elements starting at "name" or "name[i]"
+		void set_uniform_1iv(const char* name, GLsizei count, const GLint* values)
+		{
+			set(name, 1, GL_INT, count, values);
+		}
+
+		void set_uniform_1fv(const char* name, GLsizei count, const GLfloat* values)
+		{
+			set(name, 1, GL_FLOAT, count, values);
+		}
+
+		void set_uniform_2fv(const char* name, GLsizei count, const glm::vec2* values)
+		{
+			set(name, 2, GL_FLOAT, count, values);
+		}
+
+		void set_uniform_3fv(const char* name, GLsizei count, const glm::vec3* values)
+		{
+			set(name, 3, GL_FLOAT, count, values);
+		}
+
+		void set_uniform_4fv(const char* name, GLsizei count, const glm::vec4* values)
+		{
+			set(name, 4, GL_FLOAT, count, values);
+		}
+
+		void set_uniform_matrix3fv(const char* name, GLsizei count, const glm::mat3* values)
+		{
+			set(name, 9, GL_FLOAT_MAT3, count, values);
+		}
+
+		void set_uniform_matrix4fv(const char* name, GLsizei count, const glm::mat4* values)
+		{
+			set(name, 16, GL_FLOAT_MAT4, count, values);
+		}
+
+		void unbind()
+		{
+			glUseProgram(0);
+		}
+
+		~program()
+		{
+			glDeleteProgram(_id);
+		}
+
+	private:
+		program(const program&) = delete;
+		program& operator=(const program&) = delete;
+		program(program&&) = delete;
+		program&& operator=(program&&) = delete;
+	};
+};
+
+#endif
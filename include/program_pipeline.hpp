@@ -0,0 +1,168 @@
+
+#ifndef _GLIMPLIFY_PROGRAM_PIPELINE_H_
+#define _GLIMPLIFY_PROGRAM_PIPELINE_H_
+
+#include "program.hpp"
+
+namespace glimplify {
+
+	/*
+	*
+	* Combines separable single stage programs at bind time, every stage is compiled and linked once
+	* and shared by all the pipelines using it:
+	*
+	*     glimplify::program skinned_vs, static_vs, lit_fs, unlit_fs;
+	*     skinned_vs.compile_stage(GL_VERTEX_SHADER, skinned_source, 512, desc);
+	*     ...
+	*     glimplify::program_pipeline pipeline;
+	*     pipeline.use_stages(static_vs);
+	*     pipeline.use_stages(lit_fs);
+	*     pipeline.bind();
+	*
+	* A program bound with glUseProgram takes precedence over the bound pipeline, so program::unbind() first.
+	* Uniforms are set on the stage programs, which always goes through glProgramUniform* here. bind() stages
+	* again what a program object now holds, so a stage survives a hot_program swap or relink.
+	*
+	*/
+
+	class program_pipeline
+	{
+		static const int stage_count = 6;
+
+		GLuint _id;
+		// the program object and the gl program staged for every stage, so switching to the same combination
+		// again costs nothing as long as the object still holds that gl program
+		const program* _sources[stage_count];
+		GLuint _programs[stage_count];
+
+		static GLbitfield stage_bit(int stage)
+		{
+			const GLbitfield bits[stage_count] = {
+				GL_VERTEX_SHADER_BIT, GL_TESS_CONTROL_SHADER_BIT, GL_TESS_EVALUATION_SHADER_BIT,
+				GL_GEOMETRY_SHADER_BIT, GL_FRAGMENT_SHADER_BIT, GL_COMPUTE_SHADER_BIT
+			};
+			return bits[stage];
+		}
+
+	public:
+		program_pipeline()
+			: _id(0)
+		{
+			if (capabilities::current().direct_state_access())
+			{
+				glCreateProgramPipelines(1, &_id);
+			}
+			else
+			{
+				glGenProgramPipelines(1, &_id);
+			}
+
+			for (int stage = 0; stage < stage_count; ++stage)
+			{
+				_sources[stage] = nullptr;
+				_programs[stage] = 0;
+			}
+		}
+
+		// use the stages a separable program was linked with, false for a program linked without GL_PROGRAM_SEPARABLE
+		bool use_stages(const program& stages)
+		{
+			if (!stages.separable())
+			{
+				glDebugMessageInsert(GL_DEBUG_SOURCE_APPLICATION, GL_DEBUG_TYPE_ERROR, 0, GL_DEBUG_SEVERITY_HIGH, -1, "program pipeline stages need a separable program");
+				return false;
+			}
+
+			GLbitfield changed = 0;
+			for (int stage = 0; stage < stage_count; ++stage)
+			{
+				if (0 != (stages.stages() & stage_bit(stage)) && (_sources[stage] != &stages || _programs[stage] != stages.id()))
+				{
+					_sources[stage] = &stages;
+					_programs[stage] = stages.id();
+					changed |= stage_bit(stage);
+				}
+			}
+
+			if (0 != changed)
+			{
+				glUseProgramStages(_id, changed, stages.id());
+			}
+			return true;
+		}
+
+		// use `stages` of a separable program, 0 as program clears them. A bare id can't be checked for
+		// being deleted or reused, so it is always staged
+		void use_stages(GLbitfield stages, GLuint program_id)
+		{
+			for (int stage = 0; stage < stage_count; ++stage)
+			{
+				if (0 != (stages & stage_bit(stage)))
+				{
+					_sources[stage] = nullptr;
+					_programs[stage] = program_id;
+				}
+			}
+
+			glUseProgramStages(_id, stages, program_id);
+		}
+
+		void clear_stages(GLbitfield stages)
+		{
+			use_stages(stages, 0);
+		}
+
+		// checks the interfaces between the stages, a failing pipeline draws nothing
+		bool validate(GLsizei length, GLchar* desc)
+		{
+			glValidateProgramPipeline(_id);
+
+			int status = 0;
+			glGetProgramPipelineiv(_id, GL_VALIDATE_STATUS, &status);
+			if (0 == status && length > 0)
+			{
+				desc[0] = 0;
+				glGetProgramPipelineInfoLog(_id, length, NULL, desc);
+			}
+			return 0 != status;
+		}
+
+		GLuint id() const
+		{
+			return _id;
+		}
+
+		void bind()
+		{
+			// a program object swapped or relinked since it was staged holds another gl program now
+			for (int stage = 0; stage < stage_count; ++stage)
+			{
+				if (_sources[stage] && _programs[stage] != _sources[stage]->id())
+				{
+					_programs[stage] = _sources[stage]->id();
+					glUseProgramStages(_id, stage_bit(stage), _programs[stage]);
+				}
+			}
+
+			glBindProgramPipeline(_id);
+		}
+
+		void unbind()
+		{
+			glBindProgramPipeline(0);
+		}
+
+		~program_pipeline()
+		{
+			glDeleteProgramPipelines(1, &_id);
+		}
+
+	private:
+		program_pipeline(const program_pipeline&) = delete;
+		program_pipeline& operator=(const program_pipeline&) = delete;
+		program_pipeline(program_pipeline&&) = delete;
+		program_pipeline&& operator=(program_pipeline&&) = delete;
+	};
+};
+
+#endif
@@ -0,0 +1,393 @@
+
+#ifndef _GLIMPLIFY_PROGRAM_REFLECTION_H_
+#define _GLIMPLIFY_PROGRAM_REFLECTION_H_
+
+#include "capabilities.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace glimplify {
+
+	/*
+	*
+	* One active resource of a linked program.
+	* uniforms and attributes: type is the glsl type (GL_FLOAT_VEC3, GL_SAMPLER_2D, ...), size the array length,
+	* location the location of element 0. blocks: type is GL_UNIFORM_BLOCK or GL_SHADER_STORAGE_BLOCK,
+	* size the buffer size in bytes, location the buffer binding point. index is the resource index in its interface.
+	* uniforms also have the location of every element in locations, gl doesn't have to number them consecutively.
+	*
+	*/
+	struct program_resource
+	{
+		std::string name;
+		GLenum type;
+		GLint size;
+		GLint location;
+		GLuint index;
+		std::vector<GLint> locations;
+	};
+
+	/*
+	*
+	* Everything a linked program exposes, read in one pass right after the link and sorted by name,
+	* so lookups are a binary search instead of a driver call. Uses program interface query (gl 4.3)
+	* when available and the older glGetActive* queries otherwise, storage blocks only exist with the former.
+	* Array names are stored without the "[0]", uniforms and attributes inside blocks or built in (gl_*) are left out.
+	*
+	*/
+
+	class program_reflection
+	{
+		std::vector<program_resource> _uniforms;
+		std::vector<program_resource> _attributes;
+		std::vector<program_resource> _uniform_blocks;
+		std::vector<program_resource> _storage_blocks;
+
+		static void strip_array(std::string& name)
+		{
+			std::string::size_type bracket = name.rfind("[0]");
+			if (std::string::npos != bracket && bracket + 3 == name.size())
+			{
+				name.resize(bracket);
+			}
+		}
+
+		static void sort(std::vector<program_resource>& resources)
+		{
+			std::sort(resources.begin(), resources.end(), [](const program_resource& a, const program_resource& b) {
+				return a.name < b.name;
+			});
+		}
+
+		static const program_resource* find(const std::vector<program_resource>& resources, const char* name, size_t length)
+		{
+			std::vector<program_resource>::const_iterator found = std::lower_bound(resources.begin(), resources.end(), name, [length](const program_resource& resource, const char* key) {
+				return resource.name.compare(0, std::string::npos, key, length) < 0;
+			});
+
+			if (resources.end() != found && 0 == found->name.compare(0, std::string::npos, name, length))
+			{
+				return &*found;
+			}
+			return nullptr;
+		}
+
+		void query_interface(GLuint program, GLenum interface_type, std::vector<program_resource>& resources)
+		{
+			GLint count = 0, max_length = 0;
+			glGetProgramInterfaceiv(program, interface_type, GL_ACTIVE_RESOURCES, &count);
+			glGetProgramInterfaceiv(program, interface_type, GL_MAX_NAME_LENGTH, &max_length);
+
+			bool block = GL_UNIFORM_BLOCK == interface_type || GL_SHADER_STORAGE_BLOCK == interface_type;
+
+			const GLenum variable_properties[] = { GL_TYPE, GL_ARRAY_SIZE, GL_LOCATION };
+			const GLenum block_properties[] = { GL_BUFFER_DATA_SIZE, GL_BUFFER_BINDING };
+			const GLenum* properties = block ? block_properties : variable_properties;
+			GLsizei property_count = block ? 2 : 3;
+
+			std::vector<GLchar> name(max_length + 1, 0);
+			for (GLint index = 0; index < count; ++index)
+			{
+				GLint values[3] = { 0, 0, -1 };
+				glGetProgramResourceiv(program, interface_type, index, property_count, properties, 3, NULL, values);
+
+				if (!block && values[2] < 0)
+				{
+					// block members and built in variables have no location
+					continue;
+				}
+
+				glGetProgramResourceName(program, interface_type, index, max_length + 1, NULL, name.data());
+
+				program_resource resource;
+				resource.name = name.data();
+				resource.type = block ? interface_type : static_cast<GLenum>(values[0]);
+				resource.size = block ? values[0] : values[1];
+				resource.location = block ? values[1] : values[2];
+				resource.index = static_cast<GLuint>(index);
+
+				strip_array(resource.name);
+				resources.push_back(resource);
+			}
+		}
+
+		void query_legacy(GLuint program)
+		{
+			GLint count = 0, max_length = 0;
+
+			glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+			glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+			std::vector<GLchar> name(max_length + 1, 0);
+			for (GLint index = 0; index < count; ++index)
+			{
+				program_resource resource;
+				glGetActiveUniform(program, index, max_length + 1, NULL, &resource.size, &resource.type, name.data());
+				resource.location = glGetUniformLocation(program, name.data());
+				resource.index = static_cast<GLuint>(index);
+				resource.name = name.data();
+
+				if (resource.location >= 0)
+				{
+					strip_array(resource.name);
+					_uniforms.push_back(resource);
+				}
+			}
+
+			glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+			glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &max_length);
+			name.assign(max_length + 1, 0);
+			for (GLint index = 0; index < count; ++index)
+			{
+				program_resource resource;
+				glGetActiveAttrib(program, index, max_length + 1, NULL, &resource.size, &resource.type, name.data());
+				resource.location = glGetAttribLocation(program, name.data());
+				resource.index = static_cast<GLuint>(index);
+				resource.name = name.data();
+
+				if (resource.location >= 0)
+				{
+					strip_array(resource.name);
+					_attributes.push_back(resource);
+				}
+			}
+
+			glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+			glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &max_length);
+			name.assign(max_length + 1, 0);
+			for (GLint index = 0; index < count; ++index)
+			{
+				program_resource resource;
+				glGetActiveUniformBlockName(program, index, max_length + 1, NULL, name.data());
+				glGetActiveUniformBlockiv(program, index, GL_UNIFORM_BLOCK_DATA_SIZE, &resource.size);
+				glGetActiveUniformBlockiv(program, index, GL_UNIFORM_BLOCK_BINDING, &resource.location);
+				resource.type = GL_UNIFORM_BLOCK;
+				resource.index = static_cast<GLuint>(index);
+				resource.name = name.data();
+
+				strip_array(resource.name);
+				_uniform_blocks.push_back(resource);
+			}
+		}
+
+		static void locate_elements(GLuint program, program_resource& uniform)
+		{
+			uniform.locations.assign(static_cast<size_t>(std::max(uniform.size, 1)), uniform.location);
+			for (GLint element = 1; element < uniform.size; ++element)
+			{
+				std::string name = uniform.name + "[" + std::to_string(element) + "]";
+				uniform.locations[element] = glGetUniformLocation(program, name.c_str());
+				if (uniform.locations[element] < 0)
+				{
+					// an element without a location can't be set, neither can the ones after it
+					uniform.size = element;
+					uniform.locations.resize(element);
+					break;
+				}
+			}
+		}
+
+		// how many consecutive attribute locations a vertex input type takes and whether it is read as integer
+		static void input_format(GLenum type, GLint& slots, bool& integer)
+		{
+			slots = 1;
+			integer = false;
+
+			switch (type)
+			{
+			case GL_FLOAT_MAT2: case GL_FLOAT_MAT2x3: case GL_FLOAT_MAT2x4: slots = 2; break;
+			case GL_FLOAT_MAT3: case GL_FLOAT_MAT3x2: case GL_FLOAT_MAT3x4: slots = 3; break;
+			case GL_FLOAT_MAT4: case GL_FLOAT_MAT4x2: case GL_FLOAT_MAT4x3: slots = 4; break;
+			case GL_INT: case GL_INT_VEC2: case GL_INT_VEC3: case GL_INT_VEC4:
+			case GL_UNSIGNED_INT: case GL_UNSIGNED_INT_VEC2: case GL_UNSIGNED_INT_VEC3: case GL_UNSIGNED_INT_VEC4:
+				integer = true; break;
+			default:
+				break;
+			}
+		}
+
+	public:
+		program_reflection()
+		{
+		}
+
+		// read the resources of a linked program, replacing what was read before
+		void build(GLuint program)
+		{
+			clear();
+
+			if (capabilities::current().program_interface_query())
+			{
+				query_interface(program, GL_UNIFORM, _uniforms);
+				query_interface(program, GL_PROGRAM_INPUT, _attributes);
+				query_interface(program, GL_UNIFORM_BLOCK, _uniform_blocks);
+				query_interface(program, GL_SHADER_STORAGE_BLOCK, _storage_blocks);
+			}
+			else
+			{
+				query_legacy(program);
+			}
+
+			for (program_resource& uniform : _uniforms)
+			{
+				locate_elements(program, uniform);
+			}
+
+			sort(_uniforms);
+			sort(_attributes);
+			sort(_uniform_blocks);
+			sort(_storage_blocks);
+		}
+
+		void clear()
+		{
+			_uniforms.clear();
+			_attributes.clear();
+			_uniform_blocks.clear();
+			_storage_blocks.clear();
+		}
+
+		void swap(program_reflection& other)
+		{
+			_uniforms.swap(other._uniforms);
+			_attributes.swap(other._attributes);
+			_uniform_blocks.swap(other._uniform_blocks);
+			_storage_blocks.swap(other._storage_blocks);
+		}
+
+		// "name" or "name[i]", nullptr for names the program doesn't use, element is set to i
+		const program_resource* uniform(const char* name, GLint& element) const
+		{
+			element = 0;
+
+			size_t length = strlen(name);
+			if (length > 0 && ']' == name[length - 1])
+			{
+				const char* bracket = strrchr(name, '[');
+				if (bracket)
+				{
+					// only decimal digits between the brackets, "[-1]" or "[1x]" name no element
+					const char* digit = bracket + 1;
+					std::int64_t index = 0;
+					for (; digit < name + length - 1; ++digit)
+					{
+						if (*digit < '0' || *digit > '9' || index > 0x7FFFFFFF)
+						{
+							return nullptr;
+						}
+						index = index * 10 + (*digit - '0');
+					}
+
+					if (digit == bracket + 1 || index > 0x7FFFFFFF)
+					{
+						return nullptr;
+					}
+
+					element = static_cast<GLint>(index);
+					length = static_cast<size_t>(bracket - name);
+				}
+			}
+
+			const program_resource* res = find(_uniforms, name, length);
+			return (res && element < res->size) ? res : nullptr;
+		}
+
+		const program_resource* attribute(const char* name) const
+		{
+			return find(_attributes, name, strlen(name));
+		}
+
+		const program_resource* uniform_block(const char* name) const
+		{
+			return find(_uniform_blocks, name, strlen(name));
+		}
+
+		const program_resource* storage_block(const char* name) const
+		{
+			return find(_storage_blocks, name, strlen(name));
+		}
+
+		const std::vector<program_resource>& uniforms() const
+		{
+			return _uniforms;
+		}
+
+		const std::vector<program_resource>& attributes() const
+		{
+			return _attributes;
+		}
+
+		const std::vector<program_resource>& uniform_blocks() const
+		{
+			return _uniform_blocks;
+		}
+
+		const std::vector<program_resource>& storage_blocks() const
+		{
+			return _storage_blocks;
+		}
+
+		/*
+		*
+		* Check a vertex layout, fed to the attributes [first_index, first_index + count), against the program inputs
+		* before anything is drawn: every input needs a layout attribute at its location, read as integer exactly
+		* when the input is an integer type. Layout attributes the program doesn't read are fine.
+		*
+		*/
+		template <typename Layout>
+		bool matches(GLuint first_index, GLsizei length, GLchar* desc) const
+		{
+			GLint integer_mask = 0, provided_mask = 0;
+			Layout::for_each([first_index, &integer_mask, &provided_mask](auto attribute, GLuint index, GLsizei) {
+				using attribute_type = decltype(attribute);
+
+				provided_mask |= 1 << (first_index + index);
+				if (attribute_type::integer)
+				{
+					integer_mask |= 1 << (first_index + index);
+				}
+			});
+
+			for (const program_resource& input : _attributes)
+			{
+				GLint slots = 1;
+				bool integer = false;
+				input_format(input.type, slots, integer);
+
+				for (GLint slot = 0; slot < slots * input.size; ++slot)
+				{
+					GLint location = input.location + slot;
+					if (location >= 32 || 0 == (provided_mask & (1 << location)))
+					{
+						snprintf(desc, length, "vertex input %s at location %d is not fed by the layout", input.name.c_str(), location);
+						return false;
+					}
+
+					if (integer != (0 != (integer_mask & (1 << location))))
+					{
+						snprintf(desc, length, "vertex input %s at location %d is %s in the shader and %s in the layout", input.name.c_str(), location, integer ? "integer" : "float", integer ? "float" : "integer");
+						return false;
+					}
+				}
+			}
+
+			return true;
+		}
+
+		~program_reflection()
+		{
+		}
+
+	private:
+		program_reflection(const program_reflection&) = delete;
+		program_reflection& operator=(const program_reflection&) = delete;
+		program_reflection(program_reflection&&) = delete;
+		program_reflection&& operator=(program_reflection&&) = delete;
+	};
+};
+
+#endif
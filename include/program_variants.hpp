@@ -0,0 +1,210 @@
+
+#ifndef _GLIMPLIFY_PROGRAM_VARIANTS_H_
+#define _GLIMPLIFY_PROGRAM_VARIANTS_H_
+
+#include "shader_compiler.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace glimplify {
+
+	/*
+	*
+	* Shader permutations of one base source. A variant is a set of defines, "NAME" or "NAME VALUE",
+	* order doesn't matter: { "SKINNING", "LIGHT_COUNT 4" } and { "LIGHT_COUNT 4", "SKINNING" } are the same program.
+	* The defines go right after the #version line, followed by a #line so error logs still point to the base source.
+	*
+	*     glimplify::program_variants variants(vertex_source, fragment_source);
+	*     variants.warmup({ { "FOG" }, { "FOG", "ALPHA_TEST" } });     // compiled by the driver in the background
+	*     ...
+	*     glimplify::program* p = variants.variant({ "FOG" }, 512, desc);
+	*
+	*/
+
+	class program_variants
+	{
+	public:
+		using defines = std::vector<std::string>;
+
+	private:
+		enum class state
+		{
+			pending,
+			linked,
+			failed
+		};
+
+		struct entry
+		{
+			std::string key;
+			std::unique_ptr<program> target;
+			state status;
+		};
+
+		std::string _vertex_source;
+		std::string _fragment_source;
+
+		std::unordered_map<std::uint64_t, entry> _variants;
+		std::unordered_map<const program*, entry*> _owners;
+
+		shader_compiler _compiler;
+
+		static std::string canonical(defines keys)
+		{
+			std::sort(keys.begin(), keys.end());
+			keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+			std::string res;
+			for (const std::string& key : keys)
+			{
+				res += key;
+				res += '\n';
+			}
+			return res;
+		}
+
+		static std::uint64_t hash(const std::string& key)
+		{
+			// fnv-1a 64
+			std::uint64_t res = 14695981039346656037ull;
+			for (char c : key)
+			{
+				res = (res ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+			}
+			return res;
+		}
+
+		static std::string preprocess(const std::string& source, const std::string& key)
+		{
+			std::string block;
+			for (size_t begin = 0, end = key.find('\n'); std::string::npos != end; begin = end + 1, end = key.find('\n', begin))
+			{
+				block += "#define " + key.substr(begin, end - begin) + "\n";
+			}
+
+			// #version has to stay the first line
+			size_t version = source.find("#version");
+			if (std::string::npos == version)
+			{
+				return block + "#line 1\n" + source;
+			}
+
+			size_t line_end = source.find('\n', version);
+			if (std::string::npos == line_end)
+			{
+				return source + "\n" + block;
+			}
+
+			size_t line = 1 + std::count(source.begin(), source.begin() + line_end, '\n');
+
+			return source.substr(0, line_end + 1) + block + "#line " + std::to_string(line + 1) + "\n" + source.substr(line_end + 1);
+		}
+
+		entry& find_or_submit(const defines& keys)
+		{
+			std::string key = canonical(keys);
+			std::uint64_t id = hash(key);
+
+			// linear probing on the rare 64 bit collision
+			std::unordered_map<std::uint64_t, entry>::iterator found = _variants.find(id);
+			while (_variants.end() != found && found->second.key != key)
+			{
+				found = _variants.find(++id);
+			}
+
+			if (_variants.end() == found)
+			{
+				entry& res = _variants[id];
+				res.key = key;
+				res.target.reset(new program());
+				res.status = state::pending;
+				_owners[res.target.get()] = &res;
+
+				std::string vertex_source = preprocess(_vertex_source, key);
+				std::string fragment_source = preprocess(_fragment_source, key);
+				_compiler.submit(*res.target, vertex_source.c_str(), fragment_source.c_str());
+
+				return res;
+			}
+
+			return found->second;
+		}
+
+		void update(const program& target, bool linked)
+		{
+			_owners[&target]->status = linked ? state::linked : state::failed;
+		}
+
+	public:
+		explicit program_variants(const char* vertex_shader_source, const char* fragment_shader_source)
+			: _vertex_source(vertex_shader_source), _fragment_source(fragment_shader_source)
+		{
+		}
+
+		// submit variants that don't exist yet without waiting for them, poll() picks up the results
+		void warmup(const std::vector<defines>& variants)
+		{
+			for (const defines& keys : variants)
+			{
+				find_or_submit(keys);
+			}
+		}
+
+		// resolve finished warmup compiles, call once per frame while warming up, returns how many are still compiling
+		size_t poll(const shader_compiler::callback& done = nullptr)
+		{
+			return _compiler.poll([this, &done](program& target, bool linked, const char* desc) {
+				update(target, linked);
+				if (done)
+				{
+					done(target, linked, desc);
+				}
+			});
+		}
+
+		// the program for a set of defines, compiled now if it was never requested, nullptr if it doesn't link
+		program* variant(const defines& keys, GLsizei length, GLchar* desc)
+		{
+			entry& res = find_or_submit(keys);
+
+			if (state::pending == res.status)
+			{
+				// the compile log is only available once, failed variants stay failed without recompiling
+				_compiler.finish(*res.target, [this, length, desc](program& target, bool linked, const char* log) {
+					update(target, linked);
+					if (!linked && length > 0)
+					{
+						strncpy(desc, log, length - 1);
+						desc[length - 1] = 0;
+					}
+				});
+			}
+
+			return state::linked == res.status ? res.target.get() : nullptr;
+		}
+
+		size_t size() const
+		{
+			return _variants.size();
+		}
+
+		~program_variants()
+		{
+		}
+
+	private:
+		program_variants() = delete;
+		program_variants(const program_variants&) = delete;
+		program_variants& operator=(const program_variants&) = delete;
+		program_variants(program_variants&&) = delete;
+		program_variants&& operator=(program_variants&&) = delete;
+	};
+};
+
+#endif
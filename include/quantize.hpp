@@ -0,0 +1,381 @@
+
+#ifndef _GLIMPLIFY_QUANTIZE_H_
+#define _GLIMPLIFY_QUANTIZE_H_
+
+#include "layout.hpp"
+#include "simd.hpp"
+
+#include <cmath>
+#include <cstring>
+
+namespace glimplify {
+
+	/*
+	*
+	* Packed vertex formats, usable directly in a layout:
+	*
+	*     struct vertex { glimplify::half4 position; glimplify::snorm_2_10_10_10 normal; glimplify::unorm16x2 uv; };
+	*     using vertex_layout = glimplify::layout<glimplify::attr<glimplify::half4>, glimplify::attr<glimplify::snorm_2_10_10_10>, glimplify::attr<glimplify::unorm16x2>>;
+	*
+	* 16 bytes instead of 32 for the float version. There is no half3, attributes should stay 4 byte aligned,
+	* so 3 component positions use half4 and a vec3 input in the shader simply ignores w.
+	*
+	*/
+
+	struct half2 { GLhalf x, y; };
+	struct half4 { GLhalf x, y, z, w; };
+
+	struct unorm8x4 { GLubyte x, y, z, w; };
+	struct unorm16x2 { GLushort x, y; };
+	struct unorm16x4 { GLushort x, y, z, w; };
+
+	// x, y, z in 10 bit and w in 2 bit, for normals and tangents (w keeps the bitangent sign)
+	struct snorm_2_10_10_10 { GLuint value; };
+
+	template <> struct attribute_traits<half2> : attribute_format<GL_HALF_FLOAT, 2> {};
+	template <> struct attribute_traits<half4> : attribute_format<GL_HALF_FLOAT, 4> {};
+	template <> struct attribute_traits<unorm8x4> : attribute_format<GL_UNSIGNED_BYTE, 4, false, true> {};
+	template <> struct attribute_traits<unorm16x2> : attribute_format<GL_UNSIGNED_SHORT, 2, false, true> {};
+	template <> struct attribute_traits<unorm16x4> : attribute_format<GL_UNSIGNED_SHORT, 4, false, true> {};
+	template <> struct attribute_traits<snorm_2_10_10_10> : attribute_format<GL_INT_2_10_10_10_REV, 4, false, true> {};
+
+	// absolute error between the source floats and what the shader will read back
+	struct quantization_error
+	{
+		float max;
+		float mean;
+	};
+
+	inline GLhalf float_to_half(float value)
+	{
+		GLuint bits = 0;
+		memcpy(&bits, &value, sizeof(bits));
+
+		GLuint sign = (bits >> 16) & 0x8000;
+		GLuint magnitude = bits & 0x7FFFFFFF;
+
+		GLuint res = 0;
+		if (magnitude >= 0x7F800000)
+		{
+			// inf stays inf, nan stays a quiet nan
+			res = 0x7C00 | (magnitude > 0x7F800000 ? 0x0200 : 0);
+		}
+		else if (magnitude >= 0x477FF000)
+		{
+			// rounds above the largest half (65504)
+			res = 0x7C00;
+		}
+		else if (magnitude < 0x38800000)
+		{
+			// below the smallest normal half, the result is a multiple of 2^-24
+			float absolute = 0.0f;
+			memcpy(&absolute, &magnitude, sizeof(absolute));
+			res = static_cast<GLuint>(std::lrint(absolute * 16777216.0f));
+		}
+		else
+		{
+			// rebias the exponent from 127 to 15 and round the mantissa to nearest even
+			magnitude += 0xC8000FFF + ((magnitude >> 13) & 1);
+			res = magnitude >> 13;
+		}
+
+		return static_cast<GLhalf>(sign | res);
+	}
+
+	inline float half_to_float(GLhalf value)
+	{
+		GLuint sign = static_cast<GLuint>(value & 0x8000) << 16;
+		GLuint exponent = (value >> 10) & 0x1F;
+		GLuint mantissa = value & 0x3FF;
+
+		GLuint bits = 0;
+		if (0 == exponent)
+		{
+			float res = static_cast<float>(mantissa) * (1.0f / 16777216.0f);
+			return sign ? -res : res;
+		}
+		else if (0x1F == exponent)
+		{
+			bits = sign | 0x7F800000 | (mantissa << 13);
+		}
+		else
+		{
+			bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+		}
+
+		float res = 0.0f;
+		memcpy(&res, &bits, sizeof(res));
+		return res;
+	}
+
+	/*
+	*
+	* Each codec converts one float to its quantized type and back, and four at a time with sse2.
+	* The 4-wide version returns what the shader will read, which is used to measure the error.
+	*
+	*/
+
+	struct half_codec
+	{
+		using type = GLhalf;
+
+		static type encode(float value)
+		{
+			return float_to_half(value);
+		}
+
+		static float decode(type value)
+		{
+			return half_to_float(value);
+		}
+
+#ifdef GLIMPLIFY_SSE2
+		static __m128 encode4(__m128 value, type* dst)
+		{
+#ifdef GLIMPLIFY_F16C
+			__m128i halfs = _mm_cvtps_ph(value, _MM_FROUND_TO_NEAREST_INT);
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(dst), halfs);
+			return _mm_cvtph_ps(halfs);
+#else
+			float values[4];
+			_mm_storeu_ps(values, value);
+			for (int i = 0; i < 4; ++i)
+			{
+				dst[i] = encode(values[i]);
+				values[i] = decode(dst[i]);
+			}
+			return _mm_loadu_ps(values);
+#endif
+		}
+#endif
+	};
+
+	template <typename T>
+	struct unorm_codec
+	{
+		using type = T;
+
+		static type encode(float value)
+		{
+			value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+			return static_cast<type>(std::lrint(value * scale()));
+		}
+
+		static float decode(type value)
+		{
+			return static_cast<float>(value) / scale();
+		}
+
+#ifdef GLIMPLIFY_SSE2
+		static __m128 encode4(__m128 value, type* dst)
+		{
+			__m128 scaled = _mm_mul_ps(_mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(1.0f)), _mm_set1_ps(scale()));
+			// rounds to nearest even under the default rounding mode, same as std::lrint
+			__m128i integers = _mm_cvtps_epi32(scaled);
+			store4(integers, dst);
+			return _mm_div_ps(_mm_cvtepi32_ps(integers), _mm_set1_ps(scale()));
+		}
+#endif
+
+	private:
+		static float scale()
+		{
+			return static_cast<float>((1u << (8 * sizeof(type))) - 1);
+		}
+
+#ifdef GLIMPLIFY_SSE2
+		static void store4(__m128i integers, GLubyte* dst)
+		{
+			__m128i words = _mm_packs_epi32(integers, integers);
+			GLint bytes = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+			memcpy(dst, &bytes, sizeof(bytes));
+		}
+
+		static void store4(__m128i integers, GLushort* dst)
+		{
+			// sse2 has no unsigned 32 to 16 bit pack, shift into the signed range and flip the top bit back
+			__m128i shifted = _mm_sub_epi32(integers, _mm_set1_epi32(0x8000));
+			__m128i words = _mm_xor_si128(_mm_packs_epi32(shifted, shifted), _mm_set1_epi16(static_cast<short>(0x8000)));
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(dst), words);
+		}
+#endif
+	};
+
+	using unorm8_codec = unorm_codec<GLubyte>;
+	using unorm16_codec = unorm_codec<GLushort>;
+
+	/*
+	*
+	* Convert `count` elements of `components` floats each into quantized values,
+	* strides are in bytes so interleaved vertex data can be converted in place of a float stream.
+	*
+	*/
+	template <typename Codec>
+	quantization_error quantize(const void* src, size_t src_stride, GLint components, size_t count, void* dst, size_t dst_stride)
+	{
+		using type = typename Codec::type;
+
+		quantization_error res = { 0.0f, 0.0f };
+		if (0 == count || components < 1 || components > 4)
+		{
+			return res;
+		}
+
+		const unsigned char* src_bytes = static_cast<const unsigned char*>(src);
+		unsigned char* dst_bytes = static_cast<unsigned char*>(dst);
+
+		double sum = 0.0;
+
+		size_t values = count * components;
+		size_t done = 0;
+
+#ifdef GLIMPLIFY_SSE2
+		__m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+		__m128 max_error = _mm_setzero_ps();
+		__m128 sum_error = _mm_setzero_ps();
+
+		if (src_stride == components * sizeof(float) && dst_stride == components * sizeof(type))
+		{
+			// tightly packed stream, element boundaries don't matter
+			const float* floats = reinterpret_cast<const float*>(src_bytes);
+			type* quantized = reinterpret_cast<type*>(dst_bytes);
+
+			for (; done + 4 <= values; done += 4)
+			{
+				__m128 value = _mm_loadu_ps(floats + done);
+				__m128 error = _mm_and_ps(_mm_sub_ps(value, Codec::encode4(value, quantized + done)), abs_mask);
+				max_error = _mm_max_ps(max_error, error);
+				sum_error = _mm_add_ps(sum_error, error);
+			}
+		}
+		else
+		{
+			// interleaved, one element per iteration, unused lanes are zero which every codec represents exactly
+			for (size_t i = 0; i < count; ++i)
+			{
+				float value[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+				type quantized[4];
+
+				memcpy(value, src_bytes + i * src_stride, components * sizeof(float));
+
+				__m128 values4 = _mm_loadu_ps(value);
+				__m128 error = _mm_and_ps(_mm_sub_ps(values4, Codec::encode4(values4, quantized)), abs_mask);
+				max_error = _mm_max_ps(max_error, error);
+				sum_error = _mm_add_ps(sum_error, error);
+
+				memcpy(dst_bytes + i * dst_stride, quantized, components * sizeof(type));
+			}
+			done = values;
+		}
+
+		float lanes[4];
+		_mm_storeu_ps(lanes, max_error);
+		res.max = std::fmax(std::fmax(lanes[0], lanes[1]), std::fmax(lanes[2], lanes[3]));
+		_mm_storeu_ps(lanes, sum_error);
+		sum = static_cast<double>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+#endif
+
+		for (; done < values; ++done)
+		{
+			size_t element = done / components;
+			size_t component = done % components;
+
+			float value = 0.0f;
+			memcpy(&value, src_bytes + element * src_stride + component * sizeof(float), sizeof(value));
+
+			type quantized = Codec::encode(value);
+			memcpy(dst_bytes + element * dst_stride + component * sizeof(type), &quantized, sizeof(quantized));
+
+			float error = std::fabs(value - Codec::decode(quantized));
+			res.max = std::fmax(res.max, error);
+			sum += error;
+		}
+
+		res.mean = static_cast<float>(sum / values);
+
+		return res;
+	}
+
+	inline quantization_error quantize_half(const float* src, size_t src_stride, GLint components, size_t count, GLhalf* dst, size_t dst_stride)
+	{
+		return quantize<half_codec>(src, src_stride, components, count, dst, dst_stride);
+	}
+
+	inline quantization_error quantize_unorm8(const float* src, size_t src_stride, GLint components, size_t count, GLubyte* dst, size_t dst_stride)
+	{
+		return quantize<unorm8_codec>(src, src_stride, components, count, dst, dst_stride);
+	}
+
+	inline quantization_error quantize_unorm16(const float* src, size_t src_stride, GLint components, size_t count, GLushort* dst, size_t dst_stride)
+	{
+		return quantize<unorm16_codec>(src, src_stride, components, count, dst, dst_stride);
+	}
+
+	/*
+	*
+	* Normals (3 components, w = 0) or tangents (4 components, w = +-1) to GL_INT_2_10_10_10_REV,
+	* decoded by the gl 4.2 rule f = max(c / (2^(b-1) - 1), -1).
+	*
+	*/
+	inline quantization_error quantize_snorm_2_10_10_10(const float* src, size_t src_stride, GLint components, size_t count, snorm_2_10_10_10* dst, size_t dst_stride)
+	{
+		quantization_error res = { 0.0f, 0.0f };
+		if (0 == count || components < 3 || components > 4)
+		{
+			return res;
+		}
+
+		const unsigned char* src_bytes = reinterpret_cast<const unsigned char*>(src);
+		unsigned char* dst_bytes = reinterpret_cast<unsigned char*>(dst);
+
+		static const float scales[4] = { 511.0f, 511.0f, 511.0f, 1.0f };
+		static const GLuint masks[4] = { 0x3FF, 0x3FF, 0x3FF, 0x3 };
+		static const GLuint shifts[4] = { 0, 10, 20, 30 };
+
+		double sum = 0.0;
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			float value[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			memcpy(value, src_bytes + i * src_stride, components * sizeof(float));
+
+			GLint integers[4];
+			float decoded[4];
+
+#ifdef GLIMPLIFY_SSE2
+			__m128 scale = _mm_loadu_ps(scales);
+			__m128 clamped = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(value), _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+			__m128i quantized = _mm_cvtps_epi32(_mm_mul_ps(clamped, scale));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(integers), quantized);
+			_mm_storeu_ps(decoded, _mm_max_ps(_mm_div_ps(_mm_cvtepi32_ps(quantized), scale), _mm_set1_ps(-1.0f)));
+#else
+			for (int c = 0; c < 4; ++c)
+			{
+				float clamped = value[c] < -1.0f ? -1.0f : (value[c] > 1.0f ? 1.0f : value[c]);
+				integers[c] = static_cast<GLint>(std::lrint(clamped * scales[c]));
+				decoded[c] = std::fmax(integers[c] / scales[c], -1.0f);
+			}
+#endif
+
+			snorm_2_10_10_10 packed_value = { 0 };
+			for (int c = 0; c < 4; ++c)
+			{
+				packed_value.value |= (static_cast<GLuint>(integers[c]) & masks[c]) << shifts[c];
+			}
+			memcpy(dst_bytes + i * dst_stride, &packed_value, sizeof(packed_value));
+
+			for (GLint c = 0; c < components; ++c)
+			{
+				float error = std::fabs(value[c] - decoded[c]);
+				res.max = std::fmax(res.max, error);
+				sum += error;
+			}
+		}
+
+		res.mean = static_cast<float>(sum / (count * components));
+
+		return res;
+	}
+};
+
+#endif
@@ -0,0 +1,430 @@
+
+#ifndef _GLIMPLIFY_RANGE_ALLOCATOR_H_
+#define _GLIMPLIFY_RANGE_ALLOCATOR_H_
+
+#include <cstdint>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace glimplify {
+
+	/*
+	*
+	* Two level segregated fit (TLSF, Masmano et al. 2004) allocator over the integer range [0, capacity).
+	* It only does the bookkeeping, so it can hand out ranges of any resource, here ranges of gl buffers.
+	* Allocation and free are O(1): free blocks are kept in 16 size classes per power of two,
+	* two bitmaps find the first non empty class that is large enough, neighbours are merged on free.
+	*
+	*/
+
+	class range_allocator
+	{
+	public:
+		static const std::uint32_t invalid = 0xFFFFFFFF;
+
+	private:
+		static const std::uint32_t sl_log2 = 4;
+		static const std::uint32_t sl_count = 1 << sl_log2;
+		static const std::uint32_t fl_count = 32 - sl_log2 + 1;
+
+		struct node
+		{
+			std::uint32_t offset;
+			std::uint32_t size;
+
+			// neighbours in memory
+			std::uint32_t prev_physical;
+			std::uint32_t next_physical;
+
+			// neighbours in the free list of the same size class
+			std::uint32_t prev_free;
+			std::uint32_t next_free;
+
+			bool free;
+		};
+
+		std::uint32_t _capacity;
+		std::uint32_t _available;
+
+		std::vector<node> _nodes;
+		std::vector<std::uint32_t> _unused_nodes;
+
+		std::uint32_t _fl_bitmap;
+		std::uint32_t _sl_bitmap[fl_count];
+		std::uint32_t _heads[fl_count][sl_count];
+
+		static std::uint32_t most_significant_bit(std::uint32_t value)
+		{
+#ifdef _MSC_VER
+			unsigned long index = 0;
+			_BitScanReverse(&index, value);
+			return index;
+#else
+			return 31 - __builtin_clz(value);
+#endif
+		}
+
+		static std::uint32_t least_significant_bit(std::uint32_t value)
+		{
+#ifdef _MSC_VER
+			unsigned long index = 0;
+			_BitScanForward(&index, value);
+			return index;
+#else
+			return __builtin_ctz(value);
+#endif
+		}
+
+		static void mapping(std::uint32_t size, std::uint32_t& fl, std::uint32_t& sl)
+		{
+			if (size < sl_count)
+			{
+				fl = 0;
+				sl = size;
+			}
+			else
+			{
+				std::uint32_t bit = most_significant_bit(size);
+				fl = bit - sl_log2 + 1;
+				sl = (size >> (bit - sl_log2)) - sl_count;
+			}
+		}
+
+		// round up to the next size class, so any block found in that class is large enough
+		static void mapping_search(std::uint32_t size, std::uint32_t& fl, std::uint32_t& sl)
+		{
+			if (size >= sl_count)
+			{
+				std::uint32_t round = (1u << (most_significant_bit(size) - sl_log2)) - 1;
+				size = (size > 0xFFFFFFFF - round) ? 0xFFFFFFFF : size + round;
+			}
+			mapping(size, fl, sl);
+		}
+
+		std::uint32_t create_node(std::uint32_t offset, std::uint32_t size)
+		{
+			node n = { offset, size, invalid, invalid, invalid, invalid, false };
+
+			if (!_unused_nodes.empty())
+			{
+				std::uint32_t id = _unused_nodes.back();
+				_unused_nodes.pop_back();
+				_nodes[id] = n;
+				return id;
+			}
+
+			_nodes.push_back(n);
+			return static_cast<std::uint32_t>(_nodes.size() - 1);
+		}
+
+		void insert_free(std::uint32_t id)
+		{
+			node& n = _nodes[id];
+
+			std::uint32_t fl = 0, sl = 0;
+			mapping(n.size, fl, sl);
+
+			n.free = true;
+			n.prev_free = invalid;
+			n.next_free = _heads[fl][sl];
+			if (invalid != n.next_free)
+			{
+				_nodes[n.next_free].prev_free = id;
+			}
+			_heads[fl][sl] = id;
+
+			_fl_bitmap |= 1u << fl;
+			_sl_bitmap[fl] |= 1u << sl;
+		}
+
+		void remove_free(std::uint32_t id)
+		{
+			node& n = _nodes[id];
+
+			std::uint32_t fl = 0, sl = 0;
+			mapping(n.size, fl, sl);
+
+			if (invalid != n.prev_free)
+			{
+				_nodes[n.prev_free].next_free = n.next_free;
+			}
+			else
+			{
+				_heads[fl][sl] = n.next_free;
+			}
+
+			if (invalid != n.next_free)
+			{
+				_nodes[n.next_free].prev_free = n.prev_free;
+			}
+
+			if (invalid == _heads[fl][sl])
+			{
+				_sl_bitmap[fl] &= ~(1u << sl);
+				if (0 == _sl_bitmap[fl])
+				{
+					_fl_bitmap &= ~(1u << fl);
+				}
+			}
+
+			n.free = false;
+		}
+
+		std::uint32_t find_suitable(std::uint32_t fl, std::uint32_t sl) const
+		{
+			if (fl >= fl_count)
+			{
+				return invalid;
+			}
+
+			std::uint32_t sl_map = sl < 32 ? _sl_bitmap[fl] & (0xFFFFFFFF << sl) : 0;
+			if (0 == sl_map)
+			{
+				std::uint32_t fl_map = fl + 1 < 32 ? _fl_bitmap & (0xFFFFFFFF << (fl + 1)) : 0;
+				if (0 == fl_map)
+				{
+					return invalid;
+				}
+
+				fl = least_significant_bit(fl_map);
+				sl_map = _sl_bitmap[fl];
+			}
+
+			return _heads[fl][least_significant_bit(sl_map)];
+		}
+
+		// shrink `id` to size, the rest becomes a new node after it, not in any free list, which is returned
+		std::uint32_t split(std::uint32_t id, std::uint32_t size)
+		{
+			std::uint32_t rest = create_node(_nodes[id].offset + size, _nodes[id].size - size);
+
+			node& n = _nodes[id];
+			node& r = _nodes[rest];
+
+			r.prev_physical = id;
+			r.next_physical = n.next_physical;
+			if (invalid != r.next_physical)
+			{
+				_nodes[r.next_physical].prev_physical = rest;
+			}
+
+			n.next_physical = rest;
+			n.size = size;
+
+			return rest;
+		}
+
+		// merge `next` into `id`, both are physical neighbours and out of the free lists
+		void absorb(std::uint32_t id, std::uint32_t next)
+		{
+			node& n = _nodes[id];
+			node& m = _nodes[next];
+
+			n.size += m.size;
+			n.next_physical = m.next_physical;
+			if (invalid != n.next_physical)
+			{
+				_nodes[n.next_physical].prev_physical = id;
+			}
+
+			_unused_nodes.push_back(next);
+		}
+
+	public:
+		explicit range_allocator(std::uint32_t capacity)
+			: _capacity(capacity), _available(0)
+			, _fl_bitmap(0)
+		{
+			reset();
+		}
+
+		// forget every allocation, the whole range is one free block again
+		void reset()
+		{
+			_nodes.clear();
+			_unused_nodes.clear();
+
+			_fl_bitmap = 0;
+			for (std::uint32_t fl = 0; fl < fl_count; ++fl)
+			{
+				_sl_bitmap[fl] = 0;
+				for (std::uint32_t sl = 0; sl < sl_count; ++sl)
+				{
+					_heads[fl][sl] = invalid;
+				}
+			}
+
+			_available = _capacity;
+			if (_capacity > 0)
+			{
+				insert_free(create_node(0, _capacity));
+			}
+		}
+
+		// returns the allocation id, or invalid when no free block is large enough
+		std::uint32_t allocate(std::uint32_t size)
+		{
+			if (0 == size)
+			{
+				return invalid;
+			}
+
+			std::uint32_t fl = 0, sl = 0;
+			mapping_search(size, fl, sl);
+
+			std::uint32_t id = find_suitable(fl, sl);
+			if (invalid == id)
+			{
+				// the rounded up class is empty, the head of the exact class may still be large enough,
+				// e.g. a whole fresh range asked for at once
+				mapping(size, fl, sl);
+				id = _heads[fl][sl];
+				if (invalid == id || _nodes[id].size < size)
+				{
+					return invalid;
+				}
+			}
+
+			remove_free(id);
+
+			if (_nodes[id].size > size)
+			{
+				// the tail goes back to the free lists
+				insert_free(split(id, size));
+			}
+
+			_available -= size;
+
+			return id;
+		}
+
+		/*
+		*
+		* Allocate exactly [offset, offset + size), e.g. to rebuild a known layout. allocate() rounds the request up
+		* to a size class, so it may fail on a free block that fits; this takes the block containing the range.
+		* Returns invalid when the range is not inside one free block.
+		*
+		*/
+		std::uint32_t allocate_at(std::uint32_t offset, std::uint32_t size)
+		{
+			if (0 == size)
+			{
+				return invalid;
+			}
+
+			std::uint64_t end = static_cast<std::uint64_t>(offset) + size;
+
+			std::uint32_t id = invalid;
+			for (std::uint32_t i = 0; i < _nodes.size() && invalid == id; ++i)
+			{
+				const node& n = _nodes[i];
+				if (n.free && n.offset <= offset && end <= static_cast<std::uint64_t>(n.offset) + n.size)
+				{
+					id = i;
+				}
+			}
+
+			if (invalid == id)
+			{
+				return invalid;
+			}
+
+			remove_free(id);
+
+			// the part before the range stays free
+			if (_nodes[id].offset < offset)
+			{
+				std::uint32_t rest = split(id, offset - _nodes[id].offset);
+				insert_free(id);
+				id = rest;
+			}
+
+			if (_nodes[id].size > size)
+			{
+				insert_free(split(id, size));
+			}
+
+			_available -= size;
+
+			return id;
+		}
+
+		void free(std::uint32_t id)
+		{
+			_available += _nodes[id].size;
+
+			std::uint32_t prev = _nodes[id].prev_physical;
+			if (invalid != prev && _nodes[prev].free)
+			{
+				remove_free(prev);
+				absorb(prev, id);
+				id = prev;
+			}
+
+			std::uint32_t next = _nodes[id].next_physical;
+			if (invalid != next && _nodes[next].free)
+			{
+				remove_free(next);
+				absorb(id, next);
+			}
+
+			insert_free(id);
+		}
+
+		std::uint32_t offset(std::uint32_t id) const
+		{
+			return _nodes[id].offset;
+		}
+
+		std::uint32_t size(std::uint32_t id) const
+		{
+			return _nodes[id].size;
+		}
+
+		std::uint32_t capacity() const
+		{
+			return _capacity;
+		}
+
+		std::uint32_t available() const
+		{
+			return _available;
+		}
+
+		// size of the largest free block, available() - largest_free() is what fragmentation costs
+		std::uint32_t largest_free() const
+		{
+			if (0 == _fl_bitmap)
+			{
+				return 0;
+			}
+
+			std::uint32_t fl = most_significant_bit(_fl_bitmap);
+			std::uint32_t sl = most_significant_bit(_sl_bitmap[fl]);
+
+			std::uint32_t res = 0;
+			for (std::uint32_t id = _heads[fl][sl]; invalid != id; id = _nodes[id].next_free)
+			{
+				res = _nodes[id].size > res ? _nodes[id].size : res;
+			}
+
+			return res;
+		}
+
+		~range_allocator()
+		{
+		}
+
+	private:
+		range_allocator() = delete;
+		range_allocator(const range_allocator&) = delete;
+		range_allocator& operator=(const range_allocator&) = delete;
+		range_allocator(range_allocator&&) = delete;
+		range_allocator&& operator=(range_allocator&&) = delete;
+	};
+};
+
+#endif
@@ -0,0 +1,153 @@
+
+#ifndef _GLIMPLIFY_SHADER_COMPILER_H_
+#define _GLIMPLIFY_SHADER_COMPILER_H_
+
+#include "program.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+namespace glimplify {
+
+	/*
+	*
+	* Batched program compilation. Submit every program first, then poll() once per frame or finish() at the end
+	* of loading. With KHR_parallel_shader_compile the driver compiles on its own threads and poll() only resolves
+	* programs that are done; without it nothing is queried before all programs are submitted, which still lets
+	* drivers that compile lazily overlap the work.
+	*
+	*     glimplify::shader_compiler compiler;
+	*     for (permutation& p : permutations)
+	*     {
+	*         compiler.submit(p.program, p.vertex_source, p.fragment_source);
+	*     }
+	*     compiler.finish([](glimplify::program& p, bool linked, const char* desc) { ... });
+	*
+	*/
+
+	class shader_compiler
+	{
+	public:
+		using callback = std::function<void(program&, bool, const char*)>;
+
+	private:
+		GLsizei _log_length;
+
+		std::vector<program*> _pending;
+		std::vector<GLchar> _log;
+
+		void resolve(program& target, const callback& done)
+		{
+			_log[0] = 0;
+			bool linked = target.resolve(_log_length, _log.data());
+
+			if (done)
+			{
+				done(target, linked, _log.data());
+			}
+		}
+
+	public:
+		// threads: how many driver threads may compile, 0xFFFFFFFF lets the driver decide
+		explicit shader_compiler(GLuint threads = 0xFFFFFFFF, GLsizei log_length = 1024)
+			: _log_length(std::max<GLsizei>(log_length, 1)), _log(static_cast<size_t>(_log_length), 0)
+		{
+			// the entry point of the extension the driver exposes, a loader may know both but only load one
+			const capabilities& caps = capabilities::current();
+#if defined(GL_KHR_parallel_shader_compile)
+			if (caps.extension("GL_KHR_parallel_shader_compile"))
+			{
+				glMaxShaderCompilerThreadsKHR(threads);
+				return;
+			}
+#endif
+#if defined(GL_ARB_parallel_shader_compile)
+			if (caps.extension("GL_ARB_parallel_shader_compile"))
+			{
+				glMaxShaderCompilerThreadsARB(threads);
+				return;
+			}
+#endif
+			(void)caps;
+			(void)threads;
+		}
+
+		void submit(program& target, const char* vertex_shader_source, const char* fragment_shader_source)
+		{
+			target.submit(vertex_shader_source, fragment_shader_source);
+			_pending.push_back(&target);
+		}
+
+		// a separable single stage program, see program::submit_stage()
+		void submit_stage(program& target, GLenum type, const char* source)
+		{
+			target.submit_stage(type, source);
+			_pending.push_back(&target);
+		}
+
+		void submit_compute(program& target, const char* compute_shader_source)
+		{
+			target.submit_compute(compute_shader_source);
+			_pending.push_back(&target);
+		}
+
+		// resolve the programs the driver has finished, never blocks with parallel compile, returns how many are left
+		size_t poll(const callback& done)
+		{
+			size_t kept = 0;
+			for (size_t i = 0; i < _pending.size(); ++i)
+			{
+				if (_pending[i]->ready())
+				{
+					resolve(*_pending[i], done);
+				}
+				else
+				{
+					_pending[kept++] = _pending[i];
+				}
+			}
+			_pending.resize(kept);
+
+			return kept;
+		}
+
+		// resolve everything, waiting for the driver where needed
+		void finish(const callback& done)
+		{
+			for (program* target : _pending)
+			{
+				resolve(*target, done);
+			}
+			_pending.clear();
+		}
+
+		// resolve one program now if it is still pending, waiting for the driver where needed
+		void finish(program& target, const callback& done)
+		{
+			std::vector<program*>::iterator found = std::find(_pending.begin(), _pending.end(), &target);
+			if (_pending.end() != found)
+			{
+				_pending.erase(found);
+				resolve(target, done);
+			}
+		}
+
+		size_t pending() const
+		{
+			return _pending.size();
+		}
+
+		~shader_compiler()
+		{
+		}
+
+	private:
+		shader_compiler(const shader_compiler&) = delete;
+		shader_compiler& operator=(const shader_compiler&) = delete;
+		shader_compiler(shader_compiler&&) = delete;
+		shader_compiler&& operator=(shader_compiler&&) = delete;
+	};
+};
+
+#endif
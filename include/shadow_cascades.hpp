@@ -0,0 +1,493 @@
+
+#ifndef _GLIMPLIFY_SHADOW_CASCADES_H_
+#define _GLIMPLIFY_SHADOW_CASCADES_H_
+
+#include "bounds.hpp"
+#include "camera.hpp"
+#include "program.hpp"
+#include "texture.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <functional>
+#include <initializer_list>
+
+namespace glimplify {
+
+	/*
+	*
+	* Cascaded shadow maps for a directional light. The camera range is split into cascades with the practical
+	* scheme (a blend of logarithmic and uniform splits) and every cascade gets an orthographic light projection
+	* around its slice of the view frustum, rendered depth only into one layer of a GL_TEXTURE_2D_ARRAY.
+	*
+	* The projection window is the diagonal of the slice, which doesn't change when the camera turns, and its
+	* position is snapped to whole texels in a light space fixed to the world, so the shadow edges don't shimmer
+	* while the camera moves. That also keeps the matrix of a cascade unchanged for a while, so static casters are
+	* rendered into a cache only when the matrix changes and copied from there every frame, only dynamic casters
+	* are drawn each time. At most `budget` caches are rebuilt per frame, the nearest cascade first and then the
+	* ones that waited longest, a postponed cascade keeps its previous matrix meanwhile.
+	*
+	*     glimplify::shadow_cascades shadows(2048, 4, 3, context.depth());
+	*     shadows.compile(512, desc);
+	*     ...
+	*     shadows.update(camera, sun_direction);
+	*     shadows.render([&](const glimplify::shadow_pass& pass) {
+	*         pass.depth->set_uniform_matrix4fv("light_view_projection", pass.view_projection);
+	*         for (object& o : pass.static_casters ? static_objects : dynamic_objects)
+	*         {
+	*             if (pass.bounds.intersects(o.sphere)) { pass.depth->set_uniform_matrix4fv("model", o.model); draw(o); }
+	*         }
+	*     });
+	*     shadows.bind();
+	*     shadows.apply(scene_program);     // shadow_map, shadow_matrices, cascade_splits, cascade_count
+	*
+	* The scene shader declares the uniforms of shadow_cascades::glsl() and calls shadow(world_position, view_depth).
+	* The built in depth program reads the position from attribute 0, casters with their own vertex deformation
+	* bind a depth only variant of their program instead, e.g. program_variants::variant({ "DEPTH_ONLY" }).
+	*
+	*/
+
+	struct shadow_pass
+	{
+		GLuint cascade;
+		glm::mat4 view_projection;
+		// for culling the casters of this pass
+		frustum bounds;
+		bool static_casters;
+		program* depth;
+	};
+
+	class shadow_cascades
+	{
+	public:
+		using draw_casters = std::function<void(const shadow_pass&)>;
+
+		enum
+		{
+			max_cascades = 4
+		};
+
+	private:
+		struct cascade
+		{
+			float split;
+
+			// snapped window in light space, left, bottom, near, far and the window size, the key of the static cache
+			glm::vec4 window;
+			float size;
+
+			glm::mat4 view_projection;
+
+			bool cached;
+			glm::vec4 cached_window;
+			float cached_size;
+			GLuint age;
+		};
+
+		GLsizei _resolution;
+		GLuint _count;
+		GLuint _budget;
+		depth_convention _convention;
+
+		float _lambda;
+		float _distance;
+		float _caster_distance;
+
+		float _bias_factor;
+		float _bias_units;
+
+		glm::mat4 _light_view;
+		cascade _cascades[max_cascades];
+
+		texture _map;
+		texture _static;
+
+		GLuint _framebuffer;
+		GLuint _copy_framebuffer;
+
+		program _depth;
+
+		static const char* vertex_source()
+		{
+			return
+				"#version 330 core\n"
+				"layout (location = 0) in vec3 position;\n"
+				"uniform mat4 light_view_projection;\n"
+				"uniform mat4 model;\n"
+				"void main()\n"
+				"{\n"
+				"    gl_Position = light_view_projection * model * vec4(position, 1.0);\n"
+				"}\n";
+		}
+
+		static const char* fragment_source()
+		{
+			return
+				"#version 330 core\n"
+				"void main()\n"
+				"{\n"
+				"}\n";
+		}
+
+		glm::mat4 projection(const glm::vec4& window, float size) const
+		{
+			glm::mat4 res = glm::ortho(window.x, window.x + size, window.y, window.y + size, window.z, window.w);
+			if (depth_convention::reverse == _convention)
+			{
+				// the clip control is zero to one, the shadow map itself keeps near at 0 and GL_LESS
+				res = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 0.5f)) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 1.0f, 0.5f)) * res;
+			}
+			return res;
+		}
+
+		void attach(GLuint framebuffer, const texture& layers, GLuint layer)
+		{
+			glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+			glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, layers.id(), 0, static_cast<GLint>(layer));
+		}
+
+		void draw(const draw_casters& casters, GLuint index, bool static_casters)
+		{
+			shadow_pass pass;
+			pass.cascade = index;
+			pass.view_projection = _cascades[index].view_projection;
+			pass.bounds = frustum::from_matrix(pass.view_projection, _convention);
+			pass.static_casters = static_casters;
+			pass.depth = &_depth;
+
+			_depth.bind();
+			_depth.set_uniform_matrix4fv("light_view_projection", pass.view_projection);
+			_depth.set_uniform_matrix4fv("model", glm::mat4(1.0f));
+
+			casters(pass);
+		}
+
+	public:
+		/*
+		*
+		* resolution: texels per side of every cascade, count: 1 to max_cascades, budget: static cascade caches
+		* rebuilt per frame at most, convention: context::depth(), with reverse the clip control is zero to one.
+		*
+		*/
+		explicit shadow_cascades(GLsizei resolution, GLuint count, GLuint budget = max_cascades, depth_convention convention = depth_convention::standard, GLenum texture_unit = 3)
+			: _resolution(resolution), _count(std::max<GLuint>(1, std::min<GLuint>(count, max_cascades))), _budget(budget), _convention(convention)
+			, _lambda(0.75f), _distance(100.0f), _caster_distance(50.0f)
+			, _bias_factor(2.0f), _bias_units(4.0f)
+			, _light_view(1.0f)
+			, _map(texture_unit, GL_TEXTURE_2D_ARRAY), _static(texture_unit, GL_TEXTURE_2D_ARRAY)
+			, _framebuffer(0), _copy_framebuffer(0)
+		{
+			for (cascade& c : _cascades)
+			{
+				c.split = 0.0f;
+				c.window = c.cached_window = glm::vec4(0.0f);
+				c.size = c.cached_size = 0.0f;
+				c.view_projection = glm::mat4(1.0f);
+				c.cached = false;
+				c.age = 0;
+			}
+
+			_map.filter_mode(GL_LINEAR, GL_LINEAR);
+			_map.wrap_mode(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+			_map.compare_mode(GL_LEQUAL);
+			_map.storage_layers(1, GL_DEPTH_COMPONENT32F, resolution, resolution, static_cast<GLsizei>(_count));
+
+			_static.filter_mode(GL_NEAREST, GL_NEAREST);
+			_static.storage_layers(1, GL_DEPTH_COMPONENT32F, resolution, resolution, static_cast<GLsizei>(_count));
+
+			glGenFramebuffers(1, &_framebuffer);
+			glGenFramebuffers(1, &_copy_framebuffer);
+
+			// depth only, there is no color attachment to draw or read
+			GLint previous = 0;
+			glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+			for (GLuint framebuffer : { _framebuffer, _copy_framebuffer })
+			{
+				glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+				glDrawBuffer(GL_NONE);
+				glReadBuffer(GL_NONE);
+			}
+			glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previous));
+		}
+
+		bool compile(GLsizei length, GLchar* desc)
+		{
+			return _depth.compile(vertex_source(), fragment_source(), length, desc);
+		}
+
+		// how far from the camera shadows reach, the end of the last cascade
+		void distance(float value)
+		{
+			_distance = value;
+		}
+
+		// 0 splits uniformly, 1 logarithmically
+		void split_lambda(float value)
+		{
+			_lambda = value;
+		}
+
+		// how far towards the light, beyond a cascade, casters may stand
+		void caster_distance(float value)
+		{
+			_caster_distance = value;
+			invalidate();
+		}
+
+		// glPolygonOffset of the depth passes, against shadow acne
+		void bias(float factor, float units)
+		{
+			_bias_factor = factor;
+			_bias_units = units;
+		}
+
+		void budget(GLuint value)
+		{
+			_budget = value;
+		}
+
+		// static casters changed, every cache is rebuilt (within the budget)
+		void invalidate()
+		{
+			for (GLuint i = 0; i < _count; ++i)
+			{
+				_cascades[i].cached = false;
+			}
+		}
+
+		// split the view and fit the light projections, direction: where the light travels, in world space
+		void update(const camera& eye, const glm::vec3& direction)
+		{
+			glm::vec3 forward = glm::normalize(direction);
+			glm::vec3 up = std::abs(forward.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+			glm::mat4 light_view = glm::lookAt(glm::vec3(0.0f), forward, up);
+			if (light_view != _light_view)
+			{
+				_light_view = light_view;
+				invalidate();
+			}
+
+			float nearest = eye.nearest();
+			float farest = depth_convention::standard == eye.depth() ? std::min(eye.farest(), _distance) : _distance;
+
+			float tan_y = std::tan(glm::radians(eye.fov()) * 0.5f);
+			float tan_x = tan_y * eye.width() / eye.height();
+
+			float begin = nearest;
+			for (GLuint i = 0; i < _count; ++i)
+			{
+				// practical split scheme, Zhang et al. 2006
+				float t = static_cast<float>(i + 1) / _count;
+				float end = _lambda * nearest * std::pow(farest / nearest, t) + (1.0f - _lambda) * (nearest + (farest - nearest) * t);
+
+				glm::vec3 lo(FLT_MAX), hi(-FLT_MAX);
+				for (int corner = 0; corner < 8; ++corner)
+				{
+					float d = (corner & 4) ? end : begin;
+					glm::vec3 p = eye.position() + eye.front() * d
+						+ eye.right_vector() * (((corner & 1) ? d : -d) * tan_x)
+						+ eye.up_vector() * (((corner & 2) ? d : -d) * tan_y);
+
+					glm::vec3 light = glm::vec3(_light_view * glm::vec4(p, 1.0f));
+					lo = glm::min(lo, light);
+					hi = glm::max(hi, light);
+				}
+
+				// the longest diagonal of the slice bounds it in every direction, padded by the texel lost to snapping
+				float far_x = end * tan_x, far_y = end * tan_y, near_x = begin * tan_x, near_y = begin * tan_y;
+				float diagonal = std::max(2.0f * std::sqrt(far_x * far_x + far_y * far_y),
+					std::sqrt((far_x + near_x) * (far_x + near_x) + (far_y + near_y) * (far_y + near_y) + (end - begin) * (end - begin)));
+				float texel = diagonal / (_resolution - 2);
+
+				cascade& c = _cascades[i];
+				c.split = end;
+				c.size = texel * _resolution;
+
+				glm::vec2 center = (glm::vec2(lo) + glm::vec2(hi)) * 0.5f;
+				glm::vec2 corner = glm::floor((center - glm::vec2(c.size * 0.5f)) / texel) * texel;
+
+				// the light looks down -z, depth is snapped coarsely too so the matrix stays the same while the view turns
+				float depth_step = c.size * 0.5f;
+				float near_plane = std::floor((-hi.z - _caster_distance) / depth_step) * depth_step;
+				float far_plane = std::ceil(-lo.z / depth_step) * depth_step;
+
+				c.window = glm::vec4(corner, near_plane, far_plane);
+
+				begin = end;
+			}
+		}
+
+		// render the cascades, restores the framebuffer, viewport and depth state it changes
+		void render(const draw_casters& casters)
+		{
+			GLint framebuffer = 0, viewport[4] = {}, depth_func = GL_LESS;
+			GLfloat clear_depth = 1.0f;
+			glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+			glGetIntegerv(GL_VIEWPORT, viewport);
+			glGetIntegerv(GL_DEPTH_FUNC, &depth_func);
+			glGetFloatv(GL_DEPTH_CLEAR_VALUE, &clear_depth);
+			GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+
+			glViewport(0, 0, _resolution, _resolution);
+			glEnable(GL_DEPTH_TEST);
+			glDepthFunc(GL_LESS);
+			glClearDepth(1.0);
+			// casters between the light and the near plane are flattened onto it instead of clipped
+			glEnable(GL_DEPTH_CLAMP);
+			glEnable(GL_POLYGON_OFFSET_FILL);
+			glPolygonOffset(_bias_factor, _bias_units);
+
+			// the nearest cascade first, then whichever waited longest
+			GLuint order[max_cascades] = {};
+			for (GLuint i = 0; i < _count; ++i)
+			{
+				order[i] = i;
+			}
+			std::sort(order + 1, order + _count, [this](GLuint a, GLuint b) {
+				return _cascades[a].age > _cascades[b].age;
+			});
+
+			GLuint rebuilt = 0;
+			for (GLuint k = 0; k < _count; ++k)
+			{
+				cascade& c = _cascades[order[k]];
+				bool stale = !c.cached || c.window != c.cached_window || c.size != c.cached_size;
+				// a cascade that never had a cache can't be postponed
+				if (stale && (rebuilt < _budget || 0.0f == c.cached_size))
+				{
+					c.cached = true;
+					c.cached_window = c.window;
+					c.cached_size = c.size;
+					c.view_projection = projection(c.window, c.size) * _light_view;
+					c.age = 0;
+					++rebuilt;
+
+					attach(_framebuffer, _static, order[k]);
+					glClear(GL_DEPTH_BUFFER_BIT);
+					draw(casters, order[k], true);
+				}
+				else
+				{
+					// postponed cascades keep drawing with the matrix of their cache
+					c.view_projection = projection(c.cached_window, c.cached_size) * _light_view;
+					c.age += stale ? 1 : 0;
+				}
+			}
+
+			for (GLuint i = 0; i < _count; ++i)
+			{
+				// start from the static casters and add the dynamic ones
+				attach(_copy_framebuffer, _static, i);
+				attach(_framebuffer, _map, i);
+				glBindFramebuffer(GL_READ_FRAMEBUFFER, _copy_framebuffer);
+				glBlitFramebuffer(0, 0, _resolution, _resolution, 0, 0, _resolution, _resolution, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+				draw(casters, i, false);
+			}
+
+			_depth.unbind();
+
+			glDisable(GL_POLYGON_OFFSET_FILL);
+			glDisable(GL_DEPTH_CLAMP);
+			glClearDepth(clear_depth);
+			glDepthFunc(static_cast<GLenum>(depth_func));
+			if (!depth_test)
+			{
+				glDisable(GL_DEPTH_TEST);
+			}
+			glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(framebuffer));
+			glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+		}
+
+		// bind the cascades to their texture unit for the sampler2DArrayShadow
+		void bind()
+		{
+			_map.bind();
+		}
+
+		void unbind()
+		{
+			_map.unbind();
+		}
+
+		// light space to shadow map texture coordinates and depth, what shadow() in glsl() samples with
+		glm::mat4 shadow_matrix(GLuint index) const
+		{
+			float depth_scale = depth_convention::reverse == _convention ? 1.0f : 0.5f;
+			float depth_offset = depth_convention::reverse == _convention ? 0.0f : 0.5f;
+
+			glm::mat4 bias = glm::translate(glm::mat4(1.0f), glm::vec3(0.5f, 0.5f, depth_offset)) * glm::scale(glm::mat4(1.0f), glm::vec3(0.5f, 0.5f, depth_scale));
+			return bias * _cascades[index].view_projection;
+		}
+
+		// view distance where a cascade ends
+		float split(GLuint index) const
+		{
+			return _cascades[index].split;
+		}
+
+		const glm::mat4& view_projection(GLuint index) const
+		{
+			return _cascades[index].view_projection;
+		}
+
+		GLuint count() const
+		{
+			return _count;
+		}
+
+		// set the uniforms of glsl() on a scene program, bind() the cascades before drawing with it
+		void apply(program& target) const
+		{
+			glm::mat4 matrices[max_cascades];
+			GLfloat splits[max_cascades] = {};
+			for (GLuint i = 0; i < _count; ++i)
+			{
+				matrices[i] = shadow_matrix(i);
+				splits[i] = _cascades[i].split;
+			}
+
+			target.set_uniform_1i("shadow_map", static_cast<GLint>(_map.texture_unit()));
+			target.set_uniform_matrix4fv("shadow_matrices", static_cast<GLsizei>(_count), matrices);
+			target.set_uniform_1fv("cascade_splits", static_cast<GLsizei>(_count), splits);
+			target.set_uniform_1i("cascade_count", static_cast<GLint>(_count));
+		}
+
+		// glsl for the scene shader, view_depth is the distance along the view direction, 1 lit and 0 in shadow
+		static const char* glsl()
+		{
+			return
+				"uniform sampler2DArrayShadow shadow_map;\n"
+				"uniform mat4 shadow_matrices[4];\n"
+				"uniform float cascade_splits[4];\n"
+				"uniform int cascade_count;\n"
+				"float shadow(vec3 world_position, float view_depth)\n"
+				"{\n"
+				"    int cascade = 0;\n"
+				"    while (cascade < cascade_count - 1 && view_depth > cascade_splits[cascade]) ++cascade;\n"
+				"    if (view_depth > cascade_splits[cascade_count - 1]) return 1.0;\n"
+				"    vec4 p = shadow_matrices[cascade] * vec4(world_position, 1.0);\n"
+				"    return texture(shadow_map, vec4(p.xy, float(cascade), p.z));\n"
+				"}\n";
+		}
+
+		~shadow_cascades()
+		{
+			glDeleteFramebuffers(1, &_framebuffer);
+			glDeleteFramebuffers(1, &_copy_framebuffer);
+		}
+
+	private:
+		shadow_cascades() = delete;
+		shadow_cascades(const shadow_cascades&) = delete;
+		shadow_cascades& operator=(const shadow_cascades&) = delete;
+		shadow_cascades(shadow_cascades&&) = delete;
+		shadow_cascades&& operator=(shadow_cascades&&) = delete;
+	};
+};
+
+#endif
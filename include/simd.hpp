@@ -0,0 +1,22 @@
+
+#ifndef _GLIMPLIFY_SIMD_H_
+#define _GLIMPLIFY_SIMD_H_
+
+/*
+*
+* SSE2 is the baseline on every x86-64 compiler, F16C has to be enabled explicitly (-mf16c, or /arch:AVX2 on msvc).
+* Code using these macros always keeps a scalar path so other architectures still build.
+*
+*/
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GLIMPLIFY_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(GLIMPLIFY_SSE2) && (defined(__F16C__) || defined(__AVX2__))
+#define GLIMPLIFY_F16C
+#include <immintrin.h>
+#endif
+
+#endif
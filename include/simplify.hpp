@@ -0,0 +1,343 @@
+
+#ifndef _GLIMPLIFY_SIMPLIFY_H_
+#define _GLIMPLIFY_SIMPLIFY_H_
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+namespace glimplify {
+
+	/*
+	*
+	* Quadric error simplification, Garland and Heckbert 1997, "Surface Simplification Using Quadric Error Metrics".
+	* Edges collapse onto one of their vertices, so the result is a new index list over the same vertices and every
+	* level of detail can share one vertex buffer. Vertices on open borders and attribute seams (several vertices at
+	* one position) never move, so the silhouette and texture mapping stay intact.
+	*
+	* Quadrics are weighted by triangle area and keep their total weight, so a quadric error divided by the weight is
+	* the mean squared distance to the original planes a vertex stands for. Its square root, in position units, is
+	* the error reported.
+	*
+	*/
+
+	struct quadric
+	{
+		// symmetric 4x4 matrix: a00 a01 a02 a11 a12 a22, b0 b1 b2, c and the total weight
+		double m[11];
+	};
+
+	inline void add_plane(quadric& q, double nx, double ny, double nz, double d, double weight)
+	{
+		q.m[0] += weight * nx * nx; q.m[1] += weight * nx * ny; q.m[2] += weight * nx * nz;
+		q.m[3] += weight * ny * ny; q.m[4] += weight * ny * nz; q.m[5] += weight * nz * nz;
+		q.m[6] += weight * nx * d; q.m[7] += weight * ny * d; q.m[8] += weight * nz * d;
+		q.m[9] += weight * d * d;
+		q.m[10] += weight;
+	}
+
+	// mean squared distance to the planes
+	inline double quadric_error(const quadric& q, const double* p)
+	{
+		double x = p[0], y = p[1], z = p[2];
+		double res = q.m[0] * x * x + 2.0 * q.m[1] * x * y + 2.0 * q.m[2] * x * z
+			+ q.m[3] * y * y + 2.0 * q.m[4] * y * z + q.m[5] * z * z
+			+ 2.0 * (q.m[6] * x + q.m[7] * y + q.m[8] * z) + q.m[9];
+		return res > 0.0 && q.m[10] > 0.0 ? res / q.m[10] : 0.0;
+	}
+
+	/*
+	*
+	* positions: the float xyz position of the first vertex, stride: bytes between vertices.
+	* Stops at target_index_count or once the next collapse would exceed max_error, whichever comes first.
+	*
+	*/
+	inline std::vector<GLuint> simplify(const GLuint* indices, size_t index_count, const void* positions, size_t vertex_count, size_t stride,
+		size_t target_index_count, float max_error, float* result_error = nullptr)
+	{
+		std::vector<GLuint> res(indices, indices + index_count / 3 * 3);
+
+		std::vector<double> points(vertex_count * 3);
+		for (size_t v = 0; v < vertex_count; ++v)
+		{
+			float p[3];
+			memcpy(p, static_cast<const unsigned char*>(positions) + v * stride, sizeof(p));
+			points[v * 3 + 0] = p[0];
+			points[v * 3 + 1] = p[1];
+			points[v * 3 + 2] = p[2];
+		}
+
+		// vertices that share a position are one wedge, an edge of wedges used by one triangle is a border
+		std::vector<GLuint> wedge(vertex_count);
+		std::vector<bool> locked(vertex_count, false);
+		{
+			std::unordered_map<std::uint64_t, GLuint> first_at;
+			for (size_t v = 0; v < vertex_count; ++v)
+			{
+				float p[3];
+				memcpy(p, static_cast<const unsigned char*>(positions) + v * stride, sizeof(p));
+
+				std::uint32_t bits[3];
+				memcpy(bits, p, sizeof(bits));
+				std::uint64_t hash = (static_cast<std::uint64_t>(bits[0]) * 73856093u) ^ (static_cast<std::uint64_t>(bits[1]) * 19349663u) ^ (static_cast<std::uint64_t>(bits[2]) * 83492791u);
+
+				// linear probing on the rare collision of different positions
+				std::unordered_map<std::uint64_t, GLuint>::iterator found = first_at.find(hash);
+				while (first_at.end() != found && 0 != memcmp(&points[found->second * 3], &points[v * 3], 3 * sizeof(double)))
+				{
+					found = first_at.find(++hash);
+				}
+
+				if (first_at.end() == found)
+				{
+					first_at[hash] = static_cast<GLuint>(v);
+					wedge[v] = static_cast<GLuint>(v);
+				}
+				else
+				{
+					wedge[v] = found->second;
+					locked[v] = true;
+					locked[found->second] = true;
+				}
+			}
+
+			std::unordered_map<std::uint64_t, GLuint> edges;
+			for (size_t i = 0; i < res.size(); i += 3)
+			{
+				for (size_t e = 0; e < 3; ++e)
+				{
+					GLuint a = wedge[res[i + e]], b = wedge[res[i + (e + 1) % 3]];
+					++edges[(static_cast<std::uint64_t>(std::min(a, b)) << 32) | std::max(a, b)];
+				}
+			}
+
+			for (size_t i = 0; i < res.size(); i += 3)
+			{
+				for (size_t e = 0; e < 3; ++e)
+				{
+					GLuint a = res[i + e], b = res[i + (e + 1) % 3];
+					GLuint wa = wedge[a], wb = wedge[b];
+					if (1 == edges[(static_cast<std::uint64_t>(std::min(wa, wb)) << 32) | std::max(wa, wb)])
+					{
+						locked[a] = true;
+						locked[b] = true;
+					}
+				}
+			}
+		}
+
+		auto normal = [&points](GLuint a, GLuint b, GLuint c, double* n) {
+			const double* p0 = &points[a * 3];
+			const double* p1 = &points[b * 3];
+			const double* p2 = &points[c * 3];
+			double u[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			double w[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			n[0] = u[1] * w[2] - u[2] * w[1];
+			n[1] = u[2] * w[0] - u[0] * w[2];
+			n[2] = u[0] * w[1] - u[1] * w[0];
+		};
+
+		std::vector<quadric> quadrics(vertex_count);
+		memset(quadrics.data(), 0, quadrics.size() * sizeof(quadric));
+		for (size_t i = 0; i < res.size(); i += 3)
+		{
+			double n[3];
+			normal(res[i], res[i + 1], res[i + 2], n);
+
+			double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			if (length <= 0.0)
+			{
+				continue;
+			}
+
+			n[0] /= length; n[1] /= length; n[2] /= length;
+			const double* p0 = &points[res[i] * 3];
+			double d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+
+			for (size_t c = 0; c < 3; ++c)
+			{
+				add_plane(quadrics[res[i + c]], n[0], n[1], n[2], d, length * 0.5);
+			}
+		}
+
+		struct collapse
+		{
+			double cost;
+			GLuint from;
+			GLuint to;
+		};
+
+		double limit = static_cast<double>(max_error) * max_error;
+		double worst = 0.0;
+
+		std::vector<GLuint> remap(vertex_count);
+		std::vector<bool> touched(vertex_count);
+		std::vector<GLuint> offsets(vertex_count + 1);
+		std::vector<GLuint> adjacency;
+		std::vector<std::uint64_t> keys;
+		std::vector<collapse> collapses;
+
+		// a pass collapses the cheapest edges that don't share a vertex, then the index list is compacted
+		while (res.size() > target_index_count)
+		{
+			keys.clear();
+			for (size_t i = 0; i < res.size(); i += 3)
+			{
+				for (size_t e = 0; e < 3; ++e)
+				{
+					GLuint a = res[i + e], b = res[i + (e + 1) % 3];
+					keys.push_back((static_cast<std::uint64_t>(std::min(a, b)) << 32) | std::max(a, b));
+				}
+			}
+			std::sort(keys.begin(), keys.end());
+			keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+			collapses.clear();
+			for (std::uint64_t key : keys)
+			{
+				GLuint a = static_cast<GLuint>(key >> 32), b = static_cast<GLuint>(key & 0xFFFFFFFF);
+				if (locked[a] && locked[b])
+				{
+					continue;
+				}
+
+				quadric q = quadrics[a];
+				for (size_t k = 0; k < 11; ++k)
+				{
+					q.m[k] += quadrics[b].m[k];
+				}
+
+				double to_b = locked[a] ? HUGE_VAL : quadric_error(q, &points[b * 3]);
+				double to_a = locked[b] ? HUGE_VAL : quadric_error(q, &points[a * 3]);
+
+				collapse c = to_b <= to_a ? collapse{ to_b, a, b } : collapse{ to_a, b, a };
+				if (c.cost <= limit)
+				{
+					collapses.push_back(c);
+				}
+			}
+
+			if (collapses.empty())
+			{
+				break;
+			}
+
+			std::sort(collapses.begin(), collapses.end(), [](const collapse& x, const collapse& y) {
+				return x.cost < y.cost;
+			});
+
+			// vertex -> triangles
+			std::fill(offsets.begin(), offsets.end(), 0);
+			for (GLuint index : res)
+			{
+				++offsets[index + 1];
+			}
+			for (size_t v = 0; v < vertex_count; ++v)
+			{
+				offsets[v + 1] += offsets[v];
+			}
+			adjacency.resize(res.size());
+			std::vector<GLuint> fill(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < res.size(); ++i)
+			{
+				adjacency[fill[res[i]]++] = static_cast<GLuint>(i / 3);
+			}
+
+			for (size_t v = 0; v < vertex_count; ++v)
+			{
+				remap[v] = static_cast<GLuint>(v);
+			}
+			std::fill(touched.begin(), touched.end(), false);
+
+			size_t triangles = res.size() / 3;
+			size_t target_triangles = target_index_count / 3;
+			size_t collapsed = 0;
+
+			for (const collapse& c : collapses)
+			{
+				if (triangles <= target_triangles)
+				{
+					break;
+				}
+
+				if (touched[c.from] || touched[c.to])
+				{
+					continue;
+				}
+
+				// reject collapses that flip a remaining triangle
+				bool flips = false;
+				size_t removed = 0;
+				for (GLuint k = offsets[c.from]; k < offsets[c.from + 1] && !flips; ++k)
+				{
+					GLuint corners[3] = { remap[res[adjacency[k] * 3]], remap[res[adjacency[k] * 3 + 1]], remap[res[adjacency[k] * 3 + 2]] };
+					if (corners[0] == c.to || corners[1] == c.to || corners[2] == c.to)
+					{
+						++removed;
+						continue;
+					}
+
+					double before[3], after[3];
+					normal(corners[0], corners[1], corners[2], before);
+					for (GLuint& corner : corners)
+					{
+						corner = corner == c.from ? c.to : corner;
+					}
+					normal(corners[0], corners[1], corners[2], after);
+
+					flips = before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0;
+				}
+
+				if (flips)
+				{
+					continue;
+				}
+
+				remap[c.from] = c.to;
+				touched[c.from] = true;
+				touched[c.to] = true;
+
+				for (size_t k = 0; k < 11; ++k)
+				{
+					quadrics[c.to].m[k] += quadrics[c.from].m[k];
+				}
+
+				worst = std::max(worst, c.cost);
+				triangles -= std::min(triangles, removed);
+				++collapsed;
+			}
+
+			if (0 == collapsed)
+			{
+				break;
+			}
+
+			size_t kept = 0;
+			for (size_t i = 0; i < res.size(); i += 3)
+			{
+				GLuint a = remap[res[i]], b = remap[res[i + 1]], c = remap[res[i + 2]];
+				if (a != b && b != c && c != a)
+				{
+					res[kept++] = a;
+					res[kept++] = b;
+					res[kept++] = c;
+				}
+			}
+			res.resize(kept);
+		}
+
+		if (result_error)
+		{
+			*result_error = static_cast<float>(std::sqrt(worst));
+		}
+
+		return res;
+	}
+};
+
+#endif
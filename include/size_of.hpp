@@ -1,16 +1,55 @@
-
-#ifndef _GLIMPLIFY_SIZE_OF_H_
-#define _GLIMPLIFY_SIZE_OF_H_
-
-#include <glad/glad.h>
-
-namespace glimplify {
-
-	GLsizei size_of(GLenum type)
-	{
-		static const size_t sizes[7] = { sizeof(GLbyte), sizeof(GLubyte), sizeof(GLshort), sizeof(GLushort), sizeof(GLint), sizeof(GLuint), sizeof(GLfloat) };
-		return static_cast<GLsizei>(sizes[type - GL_BYTE]);
-	}
-};
-
-#endif
+
+#ifndef _GLIMPLIFY_SIZE_OF_H_
+#define _GLIMPLIFY_SIZE_OF_H_
+
+#include <glad/glad.h>
+
+namespace glimplify {
+
+	// size in bytes of one component of the given gl type, packed types report the size of the whole packed word
+	constexpr GLsizei size_of(GLenum type)
+	{
+		switch (type)
+		{
+		case GL_BYTE:
+			return sizeof(GLbyte);
+		case GL_UNSIGNED_BYTE:
+			return sizeof(GLubyte);
+		case GL_SHORT:
+			return sizeof(GLshort);
+		case GL_UNSIGNED_SHORT:
+			return sizeof(GLushort);
+		case GL_HALF_FLOAT:
+			return sizeof(GLhalf);
+		case GL_INT:
+			return sizeof(GLint);
+		case GL_UNSIGNED_INT:
+			return sizeof(GLuint);
+		case GL_FIXED:
+			return sizeof(GLfixed);
+		case GL_FLOAT:
+			return sizeof(GLfloat);
+		case GL_DOUBLE:
+			return sizeof(GLdouble);
+		case GL_INT_2_10_10_10_REV:
+		case GL_UNSIGNED_INT_2_10_10_10_REV:
+		case GL_UNSIGNED_INT_10F_11F_11F_REV:
+			return sizeof(GLuint);
+		default:
+			return 0;
+		}
+	}
+
+	constexpr bool packed(GLenum type)
+	{
+		return GL_INT_2_10_10_10_REV == type || GL_UNSIGNED_INT_2_10_10_10_REV == type || GL_UNSIGNED_INT_10F_11F_11F_REV == type;
+	}
+
+	// size in bytes of a vertex attribute made of `size` components of `type`
+	constexpr GLsizei size_of(GLenum type, GLint size)
+	{
+		return packed(type) ? size_of(type) : size_of(type) * size;
+	}
+};
+
+#endif
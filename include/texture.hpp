@@ -1,99 +1,473 @@
-
-#ifndef _GLIMPLIFY_TEXTURE_H_
-#define _GLIMPLIFY_TEXTURE_H_
-
-#include <glad/glad.h>
-
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb/stb_image.h"
-
-namespace glimplify {
-
-	class texture
-	{
-		GLenum _texture_unit;
-
-		GLuint _id;
-
-		GLint _width;
-		GLint _aligned_width;
-		GLint _height;
-		GLint _channels;
-
-	public:
-		texture(GLenum texture_unit = 0)
-			: _texture_unit(texture_unit), _id(0)
-			, _width(0), _aligned_width(0), _height(0), _channels(0)
-		{
-			glGenTextures(1, &_id);
-		}
-
-		void bind()
-		{
-			glActiveTexture(GL_TEXTURE0 + _texture_unit);
-			glBindTexture(GL_TEXTURE_2D, _id);
-		}
-
-		void wrap_mode(GLint s_mode, GLint t_mode)
-		{
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, s_mode);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, t_mode);
-		}
-
-		void filter_mode(GLint min_mode, GLint mag_mode)
-		{
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_mode);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mag_mode);
-		}
-
-		void load(const char* image_path, bool flip_on_vertical, bool generate_mipmap = false)
-		{
-			if (flip_on_vertical)
-			{
-				stbi_set_flip_vertically_on_load(true);
-			}
-
-			unsigned char* data = stbi_load(image_path, &_width, &_height, &_channels, 0);
-
-			if (data)
-			{
-				_aligned_width = _width;
-
-				if (_channels > 3)
-				{
-					glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, _width, _height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-				}
-				else
-				{
-					glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, _width, _height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-				}
-
-				if (generate_mipmap)
-				{
-					glGenerateMipmap(GL_TEXTURE_2D);
-				}
-
-				stbi_image_free(data);
-			}
-		}
-
-		void unbind()
-		{
-			glBindTexture(GL_TEXTURE_2D, 0);
-			glActiveTexture(GL_TEXTURE0);
-		}
-
-		~texture()
-		{
-			glDeleteTextures(1, &_id);
-		}
-
-	private:
-		texture(const texture&) = delete;
-		texture& operator=(const texture&) = delete;
-		texture(texture&&) = delete;
-		texture&& operator=(texture&&) = delete;
-	};
-};
-
-#endif
+
+#ifndef _GLIMPLIFY_TEXTURE_H_
+#define _GLIMPLIFY_TEXTURE_H_
+
+#include "capabilities.hpp"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb/stb_image.h"
+
+#include <cstdint>
+
+namespace glimplify {
+
+	/*
+	*
+	* With direct state access (gl 4.5) the texture is edited by name and never bound for setup,
+	* otherwise it binds itself to its texture unit before every edit.
+	*
+	*/
+
+	class texture
+	{
+		bool _dsa;
+		// immutable storage (gl 4.2), otherwise storage*() allocate mutable levels one by one
+		bool _storage;
+		bool _storage_multisample;
+
+		GLenum _texture_unit;
+		// GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY or GL_TEXTURE_2D_MULTISAMPLE
+		GLenum _target;
+
+		GLuint _id;
+		// unique per created gl texture, gl hands a deleted name out again
+		std::uint64_t _generation;
+
+		GLint _width;
+		GLint _aligned_width;
+		GLint _height;
+		GLint _layers;
+		GLsizei _samples;
+		GLint _channels;
+
+		// kept to be reapplied when immutable storage forces a new texture object
+		GLint _wrap_s;
+		GLint _wrap_t;
+		GLint _min_filter;
+		GLint _mag_filter;
+		GLenum _compare_func;
+
+		void create()
+		{
+			// textures are created on the gl thread only
+			static std::uint64_t generations = 0;
+			_generation = ++generations;
+
+			if (_dsa)
+			{
+				glCreateTextures(_target, 1, &_id);
+			}
+			else
+			{
+				glGenTextures(1, &_id);
+			}
+		}
+
+		void parameter(GLenum name, GLint value)
+		{
+			if (_dsa)
+			{
+				glTextureParameteri(_id, name, value);
+			}
+			else
+			{
+				bind();
+				glTexParameteri(_target, name, value);
+			}
+		}
+
+		// a client format and type glTexImage* accepts with internal_format when no data is uploaded
+		static void transfer_format(GLenum internal_format, GLenum& format, GLenum& type)
+		{
+			format = GL_RGBA;
+			type = GL_FLOAT;
+
+			switch (internal_format)
+			{
+			case GL_DEPTH_COMPONENT16: case GL_DEPTH_COMPONENT24: case GL_DEPTH_COMPONENT32: case GL_DEPTH_COMPONENT32F:
+				format = GL_DEPTH_COMPONENT; break;
+			case GL_DEPTH24_STENCIL8:
+				format = GL_DEPTH_STENCIL; type = GL_UNSIGNED_INT_24_8; break;
+			case GL_DEPTH32F_STENCIL8:
+				format = GL_DEPTH_STENCIL; type = GL_FLOAT_32_UNSIGNED_INT_24_8_REV; break;
+			case GL_R8UI: case GL_R16UI: case GL_R32UI: case GL_RG8UI: case GL_RG16UI: case GL_RG32UI: case GL_RGBA8UI: case GL_RGBA16UI: case GL_RGBA32UI:
+				format = GL_RGBA_INTEGER; type = GL_UNSIGNED_INT; break;
+			case GL_R8I: case GL_R16I: case GL_R32I: case GL_RG8I: case GL_RG16I: case GL_RG32I: case GL_RGBA8I: case GL_RGBA16I: case GL_RGBA32I:
+				format = GL_RGBA_INTEGER; type = GL_INT; break;
+			default:
+				// normalized and float color formats take any color format
+				break;
+			}
+		}
+
+		// mutable levels like glTexStorage2D/3D would allocate them, layers 0 for a 2d texture
+		void image_levels(GLsizei levels, GLenum internal_format, GLsizei width, GLsizei height, GLsizei layers)
+		{
+			GLenum format = 0, type = 0;
+			transfer_format(internal_format, format, type);
+
+			bind();
+			for (GLint level = 0; level < levels; ++level)
+			{
+				GLsizei level_width = width >> level > 1 ? width >> level : 1;
+				GLsizei level_height = height >> level > 1 ? height >> level : 1;
+				if (layers > 0)
+				{
+					glTexImage3D(_target, level, internal_format, level_width, level_height, layers, 0, format, type, NULL);
+				}
+				else
+				{
+					glTexImage2D(_target, level, internal_format, level_width, level_height, 0, format, type, NULL);
+				}
+			}
+
+			// the missing levels would leave the texture incomplete for mipmap filters
+			glTexParameteri(_target, GL_TEXTURE_BASE_LEVEL, 0);
+			glTexParameteri(_target, GL_TEXTURE_MAX_LEVEL, levels - 1);
+		}
+
+		// storage is immutable, allocating again needs a new texture object with the same parameters
+		void recreate_if_immutable()
+		{
+			GLint immutable = 0;
+			if (_dsa)
+			{
+				glGetTextureParameteriv(_id, GL_TEXTURE_IMMUTABLE_FORMAT, &immutable);
+			}
+			else
+			{
+				bind();
+				glGetTexParameteriv(_target, GL_TEXTURE_IMMUTABLE_FORMAT, &immutable);
+			}
+
+			if (immutable)
+			{
+				glDeleteTextures(1, &_id);
+				create();
+
+				// multisample textures have no sampler state
+				if (GL_TEXTURE_2D_MULTISAMPLE == _target)
+				{
+					return;
+				}
+
+				wrap_mode(_wrap_s, _wrap_t);
+				filter_mode(_min_filter, _mag_filter);
+				if (GL_NONE != _compare_func)
+				{
+					compare_mode(_compare_func);
+				}
+			}
+		}
+
+	public:
+		// target: GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY with storage_layers() or GL_TEXTURE_2D_MULTISAMPLE with storage_multisample()
+		texture(GLenum texture_unit = 0, GLenum target = GL_TEXTURE_2D)
+			: _dsa(capabilities::current().direct_state_access())
+			, _storage(capabilities::current().texture_storage()), _storage_multisample(capabilities::current().texture_storage_multisample())
+			, _texture_unit(texture_unit), _target(target), _id(0), _generation(0)
+			, _width(0), _aligned_width(0), _height(0), _layers(1), _samples(1), _channels(0)
+			, _wrap_s(GL_REPEAT), _wrap_t(GL_REPEAT), _min_filter(GL_NEAREST_MIPMAP_LINEAR), _mag_filter(GL_LINEAR), _compare_func(GL_NONE)
+		{
+			create();
+		}
+
+		void bind()
+		{
+			if (_dsa)
+			{
+				glBindTextureUnit(_texture_unit, _id);
+			}
+			else
+			{
+				glActiveTexture(GL_TEXTURE0 + _texture_unit);
+				glBindTexture(_target, _id);
+			}
+		}
+
+		// bind one level to an image unit for imageLoad/imageStore, format must match the texture storage
+		void bind_image(GLuint unit, GLint level, GLenum access, GLenum format)
+		{
+			glBindImageTexture(unit, _id, level, GL_FALSE, 0, access, format);
+		}
+
+		GLuint id() const
+		{
+			return _id;
+		}
+
+		// changes whenever the texture object is created again, e.g. for new immutable storage
+		std::uint64_t generation() const
+		{
+			return _generation;
+		}
+
+		void wrap_mode(GLint s_mode, GLint t_mode)
+		{
+			_wrap_s = s_mode;
+			_wrap_t = t_mode;
+
+			parameter(GL_TEXTURE_WRAP_S, s_mode);
+			parameter(GL_TEXTURE_WRAP_T, t_mode);
+		}
+
+		void filter_mode(GLint min_mode, GLint mag_mode)
+		{
+			_min_filter = min_mode;
+			_mag_filter = mag_mode;
+
+			parameter(GL_TEXTURE_MIN_FILTER, min_mode);
+			parameter(GL_TEXTURE_MAG_FILTER, mag_mode);
+		}
+
+		// depth textures: sample as a shadow sampler comparing against func, e.g. GL_LEQUAL, GL_NONE turns it off
+		void compare_mode(GLenum func)
+		{
+			_compare_func = func;
+
+			parameter(GL_TEXTURE_COMPARE_MODE, GL_NONE == func ? GL_NONE : GL_COMPARE_REF_TO_TEXTURE);
+			if (GL_NONE != func)
+			{
+				parameter(GL_TEXTURE_COMPARE_FUNC, func);
+			}
+		}
+
+		void load(const char* image_path, bool flip_on_vertical, bool generate_mipmap = false)
+		{
+			if (flip_on_vertical)
+			{
+				stbi_set_flip_vertically_on_load(true);
+			}
+
+			unsigned char* data = stbi_load(image_path, &_width, &_height, &_channels, 0);
+
+			if (data)
+			{
+				_aligned_width = _width;
+				_layers = 1;
+				_samples = 1;
+
+				static const GLenum formats[4] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+				static const GLenum internal_formats[4] = { GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+				GLint index = (_channels < 1 ? 1 : (_channels > 4 ? 4 : _channels)) - 1;
+				GLenum format = formats[index];
+
+				// stb rows are tightly packed, gl expects 4 byte aligned rows by default
+				bool packed = 0 != (_width * (index + 1)) % 4;
+				if (packed)
+				{
+					glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+				}
+
+				recreate_if_immutable();
+
+				if (_dsa)
+				{
+					GLsizei levels = 1;
+					if (generate_mipmap)
+					{
+						for (GLint size = _width > _height ? _width : _height; size > 1; size >>= 1)
+						{
+							++levels;
+						}
+					}
+
+					glTextureStorage2D(_id, levels, internal_formats[index], _width, _height);
+					glTextureSubImage2D(_id, 0, 0, 0, _width, _height, format, GL_UNSIGNED_BYTE, data);
+
+					if (generate_mipmap)
+					{
+						glGenerateTextureMipmap(_id);
+					}
+				}
+				else
+				{
+					bind();
+
+					glTexImage2D(_target, 0, internal_formats[index], _width, _height, 0, format, GL_UNSIGNED_BYTE, data);
+
+					if (generate_mipmap)
+					{
+						glGenerateMipmap(_target);
+					}
+				}
+
+				if (packed)
+				{
+					glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+				}
+
+				stbi_image_free(data);
+			}
+		}
+
+		// empty immutable storage for render or compute results, e.g. GL_R32F or GL_DEPTH_COMPONENT32F
+		void storage(GLsizei levels, GLenum internal_format, GLsizei width, GLsizei height)
+		{
+			recreate_if_immutable();
+
+			_width = _aligned_width = width;
+			_height = height;
+			_layers = 1;
+			_samples = 1;
+			_channels = 0;
+
+			if (_dsa)
+			{
+				glTextureStorage2D(_id, levels, internal_format, width, height);
+			}
+			else if (_storage)
+			{
+				bind();
+				glTexStorage2D(GL_TEXTURE_2D, levels, internal_format, width, height);
+			}
+			else
+			{
+				image_levels(levels, internal_format, width, height, 0);
+			}
+		}
+
+		// empty immutable storage for a GL_TEXTURE_2D_ARRAY, every layer is width x height
+		void storage_layers(GLsizei levels, GLenum internal_format, GLsizei width, GLsizei height, GLsizei layers)
+		{
+			recreate_if_immutable();
+
+			_width = _aligned_width = width;
+			_height = height;
+			_layers = layers;
+			_samples = 1;
+			_channels = 0;
+
+			if (_dsa)
+			{
+				glTextureStorage3D(_id, levels, internal_format, width, height, layers);
+			}
+			else if (_storage)
+			{
+				bind();
+				glTexStorage3D(_target, levels, internal_format, width, height, layers);
+			}
+			else
+			{
+				image_levels(levels, internal_format, width, height, layers);
+			}
+		}
+
+		// empty immutable storage for a GL_TEXTURE_2D_MULTISAMPLE render target, resolved with framebuffer::resolve()
+		void storage_multisample(GLsizei samples, GLenum internal_format, GLsizei width, GLsizei height)
+		{
+			recreate_if_immutable();
+
+			_width = _aligned_width = width;
+			_height = height;
+			_layers = 1;
+			_samples = samples;
+			_channels = 0;
+
+			if (_dsa)
+			{
+				glTextureStorage2DMultisample(_id, samples, internal_format, width, height, GL_TRUE);
+			}
+			else if (_storage_multisample)
+			{
+				bind();
+				glTexStorage2DMultisample(_target, samples, internal_format, width, height, GL_TRUE);
+			}
+			else
+			{
+				bind();
+				glTexImage2DMultisample(_target, samples, internal_format, width, height, GL_TRUE);
+			}
+		}
+
+		// copy a rectangle of the read framebuffer into a level, depth formats copy the depth buffer
+		void copy_framebuffer(GLint level, GLint x, GLint y, GLsizei width, GLsizei height)
+		{
+			if (_dsa)
+			{
+				glCopyTextureSubImage2D(_id, level, 0, 0, x, y, width, height);
+			}
+			else
+			{
+				bind();
+				glCopyTexSubImage2D(_target, level, 0, 0, x, y, width, height);
+			}
+		}
+
+		// read a level back to the cpu, waits for the gpu
+		void read(GLint level, GLenum format, GLenum type, GLsizei size, void* data)
+		{
+			if (_dsa)
+			{
+				glGetTextureImage(_id, level, format, type, size, data);
+			}
+			else
+			{
+				bind();
+				glGetTexImage(_target, level, format, type, data);
+			}
+		}
+
+		GLint width() const
+		{
+			return _width;
+		}
+
+		GLint height() const
+		{
+			return _height;
+		}
+
+		GLint layers() const
+		{
+			return _layers;
+		}
+
+		GLsizei samples() const
+		{
+			return _samples;
+		}
+
+		GLenum texture_unit() const
+		{
+			return _texture_unit;
+		}
+
+		// the unit bind() uses from now on
+		void texture_unit(GLenum unit)
+		{
+			_texture_unit = unit;
+		}
+
+		GLenum target() const
+		{
+			return _target;
+		}
+
+		void unbind()
+		{
+			if (_dsa)
+			{
+				glBindTextureUnit(_texture_unit, 0);
+			}
+			else
+			{
+				glBindTexture(_target, 0);
+				glActiveTexture(GL_TEXTURE0);
+			}
+		}
+
+		~texture()
+		{
+			glDeleteTextures(1, &_id);
+		}
+
+	private:
+		texture(const texture&) = delete;
+		texture& operator=(const texture&) = delete;
+		texture(texture&&) = delete;
+		texture&& operator=(texture&&) = delete;
+	};
+};
+
+#endif
@@ -0,0 +1,186 @@
+
+#ifndef _GLIMPLIFY_VERTEX_FORMAT_H_
+#define _GLIMPLIFY_VERTEX_FORMAT_H_
+
+#include "buffer.hpp"
+#include "layout.hpp"
+
+namespace glimplify {
+
+	/*
+	*
+	* A vertex array that only describes the vertex format (gl 4.3 vertex attrib binding), buffers are attached per draw:
+	*
+	*     glimplify::vertex_format format;
+	*     format.stream<position_layout>(0);     // binding 0, attributes 0..
+	*     format.stream<attribute_layout>(1);    // binding 1, following attributes
+	*
+	*     format.bind();
+	*     for (mesh& m : meshes)
+	*     {
+	*         format.bind_vertices(0, m.positions);
+	*         format.bind_vertices(1, m.attributes);
+	*         format.bind_index(m.indices);
+	*         glDrawElements(...);
+	*     }
+	*
+	* One format per vertex layout is enough for any number of meshes, switching meshes only swaps buffer bindings.
+	* Without vertex attrib binding (before gl 4.3) bind_vertices() points the binding's attributes at the buffer
+	* with glVertexAttribPointer instead, the format is kept to do that.
+	*
+	*/
+
+	class vertex_format
+	{
+	public:
+		static const GLuint max_bindings = 16;
+		// what stream() returns for a binding past max_bindings
+		static const GLuint invalid = 0xFFFFFFFF;
+
+	private:
+		// the attributes of a binding, for the glVertexAttribPointer fallback
+		struct stream_format
+		{
+			void (*apply)(GLuint first_index, GLintptr base);
+			GLuint first_index;
+		};
+
+		bool _dsa;
+		bool _attrib_binding;
+
+		GLuint _vao;
+		GLuint _attributes;
+
+		GLsizei _strides[max_bindings];
+		stream_format _streams[max_bindings];
+
+	public:
+		vertex_format()
+			: _dsa(capabilities::current().direct_state_access())
+			, _attrib_binding(capabilities::current().vertex_attrib_binding())
+			, _vao(0), _attributes(0), _strides(), _streams()
+		{
+			if (_dsa)
+			{
+				glCreateVertexArrays(1, &_vao);
+			}
+			else
+			{
+				glGenVertexArrays(1, &_vao);
+			}
+		}
+
+		// attributes of Layout read from buffer binding slot `binding`, advanced per instance when divisor > 0,
+		// they take the next free attribute indices and the first one is returned, invalid for a binding out of range
+		template <typename Layout>
+		GLuint stream(GLuint binding, GLuint divisor = 0)
+		{
+			if (binding >= max_bindings)
+			{
+				return invalid;
+			}
+
+			GLuint first_index = _attributes;
+			_attributes += Layout::count;
+			_strides[binding] = Layout::stride();
+			_streams[binding] = stream_format{ &Layout::apply, first_index };
+
+			if (_dsa)
+			{
+				Layout::apply_named(_vao, binding, first_index);
+				glVertexArrayBindingDivisor(_vao, binding, divisor);
+			}
+			else if (_attrib_binding)
+			{
+				glBindVertexArray(_vao);
+				Layout::apply_format(binding, first_index);
+				glVertexBindingDivisor(binding, divisor);
+			}
+			else
+			{
+				// the pointers are set by bind_vertices(), the divisors are vertex array state already
+				glBindVertexArray(_vao);
+				for (GLuint i = 0; i < Layout::count; ++i)
+				{
+					glVertexAttribDivisor(first_index + i, divisor);
+				}
+			}
+
+			return first_index;
+		}
+
+		GLsizei stride(GLuint binding) const
+		{
+			return binding < max_bindings ? _strides[binding] : 0;
+		}
+
+		void bind()
+		{
+			glBindVertexArray(_vao);
+		}
+
+		// without direct state access the format has to be bound
+		void bind_vertices(GLuint binding, const buffer& vertices, GLintptr offset = 0)
+		{
+			bind_vertices(binding, vertices.id(), offset);
+		}
+
+		void bind_vertices(GLuint binding, GLuint vertices, GLintptr offset = 0)
+		{
+			if (binding >= max_bindings)
+			{
+				return;
+			}
+
+			if (_dsa)
+			{
+				glVertexArrayVertexBuffer(_vao, binding, vertices, offset, _strides[binding]);
+			}
+			else if (_attrib_binding)
+			{
+				glBindVertexBuffer(binding, vertices, offset, _strides[binding]);
+			}
+			else if (_streams[binding].apply)
+			{
+				glBindBuffer(GL_ARRAY_BUFFER, vertices);
+				_streams[binding].apply(_streams[binding].first_index, offset);
+			}
+		}
+
+		// without direct state access the format has to be bound
+		void bind_index(const buffer& indices)
+		{
+			bind_index(indices.id());
+		}
+
+		void bind_index(GLuint indices)
+		{
+			if (_dsa)
+			{
+				glVertexArrayElementBuffer(_vao, indices);
+			}
+			else
+			{
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices);
+			}
+		}
+
+		void unbind()
+		{
+			glBindVertexArray(0);
+		}
+
+		~vertex_format()
+		{
+			glDeleteVertexArrays(1, &_vao);
+		}
+
+	private:
+		vertex_format(const vertex_format&) = delete;
+		vertex_format& operator=(const vertex_format&) = delete;
+		vertex_format(vertex_format&&) = delete;
+		vertex_format&& operator=(vertex_format&&) = delete;
+	};
+};
+
+#endif
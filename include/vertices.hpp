@@ -1,84 +1,118 @@
-
-#ifndef _GLIMPLIFY_VERTICES_H_
-#define _GLIMPLIFY_VERTICES_H_
-
-#include "size_of.hpp"
-
-#include <vector>
-#include <numeric>
-
-namespace glimplify {
-
-	class vertices
-	{
-		GLuint _vao;
-		GLuint _vbo;
-		GLuint _ebo;
-
-		GLsizei _stride;
-
-		std::vector<GLsizei> _attribute_size;
-
-	public:
-		explicit vertices(GLuint attributes, GLsizei stride)
-			: _vao(0), _vbo(0), _ebo(0)
-			, _attribute_size(attributes, 0)
-			, _stride(stride)
-		{
-			glGenVertexArrays(1, &_vao);
-			glGenBuffers(1, &_vbo);
-		}
-
-		void bind()
-		{
-			glBindVertexArray(_vao);
-		}
-
-		void allocate_vertices(GLsizeiptr size, const void* data, GLenum usage)
-		{
-			glBindBuffer(GL_ARRAY_BUFFER, _vbo);
-			glBufferData(GL_ARRAY_BUFFER, size, data, usage);
-		}
-
-		void format_vertices(GLuint index, GLenum type, GLint size)
-		{
-			_attribute_size[index] = size_of(type) * size;
-
-			glVertexAttribPointer(index, size, type, GL_FALSE, _stride, (const void*)(GLsizeiptr)(std::accumulate(_attribute_size.begin(), _attribute_size.begin() + index, 0)));
-			glEnableVertexAttribArray(index);
-		}
-
-		void allocate_index(GLsizeiptr size, const void* data, GLenum usage)
-		{
-			glGenBuffers(1, &_ebo);
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ebo);
-			glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, data, usage);
-		}
-
-		void unbind()
-		{
-			glBindBuffer(GL_ARRAY_BUFFER, 0);
-			glBindVertexArray(0);
-		}
-
-		~vertices()
-		{
-			glDeleteVertexArrays(1, &_vao);
-			glDeleteBuffers(1, &_vbo);
-
-			if (_ebo > 0)
-			{
-				glDeleteBuffers(1, &_ebo);
-			}
-		}
-
-	private:
-		vertices() = delete;
-		vertices(const vertices&) = delete;
-		vertices& operator=(const vertices&) = delete;
-		vertices(vertices&&) = delete;
-		vertices&& operator=(vertices&&) = delete;
-	};
-};
-
-#endif
+
+#ifndef _GLIMPLIFY_VERTICES_H_
+#define _GLIMPLIFY_VERTICES_H_
+
+#include "buffer.hpp"
+#include "layout.hpp"
+#include "mesh.hpp"
+
+namespace glimplify {
+
+	/*
+	*
+	* With direct state access (gl 4.5) nothing has to be bound to set up the vertex array,
+	* otherwise the methods bind the vertex array and buffers they edit themselves.
+	*
+	*/
+
+	class vertices
+	{
+		bool _dsa;
+
+		GLuint _vao;
+		buffer _vbo;
+		buffer _ebo;
+
+		GLsizei _stride;
+
+	public:
+		vertices()
+			: _dsa(capabilities::current().direct_state_access())
+			, _vao(0), _vbo(), _ebo(), _stride(0)
+		{
+			if (_dsa)
+			{
+				glCreateVertexArrays(1, &_vao);
+			}
+			else
+			{
+				glGenVertexArrays(1, &_vao);
+			}
+		}
+
+		void bind()
+		{
+			glBindVertexArray(_vao);
+		}
+
+		void allocate_vertices(GLsizeiptr size, const void* data, GLenum usage)
+		{
+			bool recreated = _vbo.allocate(GL_ARRAY_BUFFER, size, data, usage);
+
+			if (_dsa && recreated && _stride > 0)
+			{
+				glVertexArrayVertexBuffer(_vao, 0, _vbo.id(), 0, _stride);
+			}
+		}
+
+		template <typename Layout>
+		void format_vertices(GLuint first_index = 0)
+		{
+			_stride = Layout::stride();
+
+			if (_dsa)
+			{
+				Layout::apply_named(_vao, 0, first_index);
+				glVertexArrayVertexBuffer(_vao, 0, _vbo.id(), 0, _stride);
+			}
+			else
+			{
+				glBindVertexArray(_vao);
+				_vbo.bind(GL_ARRAY_BUFFER);
+				Layout::apply(first_index);
+			}
+		}
+
+		void allocate_index(GLsizeiptr size, const void* data, GLenum usage)
+		{
+			if (_dsa)
+			{
+				_ebo.allocate(GL_ELEMENT_ARRAY_BUFFER, size, data, usage);
+				glVertexArrayElementBuffer(_vao, _ebo.id());
+			}
+			else
+			{
+				// the element array binding is part of the vertex array state
+				glBindVertexArray(_vao);
+				_ebo.allocate(GL_ELEMENT_ARRAY_BUFFER, size, data, usage);
+			}
+		}
+
+		void allocate_index(const index_buffer& indices, GLenum usage)
+		{
+			allocate_index(static_cast<GLsizeiptr>(indices.data.size()), indices.data.data(), usage);
+		}
+
+		void unbind()
+		{
+			if (!_dsa)
+			{
+				glBindBuffer(GL_ARRAY_BUFFER, 0);
+			}
+			glBindVertexArray(0);
+		}
+
+		~vertices()
+		{
+			glDeleteVertexArrays(1, &_vao);
+		}
+
+	private:
+		vertices(const vertices&) = delete;
+		vertices& operator=(const vertices&) = delete;
+		vertices(vertices&&) = delete;
+		vertices&& operator=(vertices&&) = delete;
+	};
+};
+
+#endif
@@ -1,312 +1,392 @@
-
-
-#include "vertices.hpp"
-#include "program.hpp"
-
-#include "texture.hpp"
-
-#include "camera.hpp"
-
-#include "context.hpp"
-
-#include <GLFW/glfw3.h>
-
-#include <iostream>
-
-// settings
-const unsigned int SCR_WIDTH = 800;
-const unsigned int SCR_HEIGHT = 600;
-
-void framebuffer_size_callback(GLFWwindow* window, int width, int height);
-
-
-bool firstMouse = true;
-float lastFrame = 0.0f; // Time of last frame
-// process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
-// ---------------------------------------------------------------------------------------------------------
-void processInput(GLFWwindow* window, glimplify::camera& camera)
-{
-	float now = glfwGetTime();
-
-	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
-		glfwSetWindowShouldClose(window, true);
-
-	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        camera.forward(now - lastFrame);
-	if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-		camera.backward(now - lastFrame);
-	if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-		camera.left(now - lastFrame);
-	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-		camera.right(now - lastFrame);
-
-    lastFrame = now;
-}
-
-float lastX = SCR_WIDTH >> 1, lastY = SCR_HEIGHT >> 1;
-
-glimplify::camera camera(SCR_WIDTH, SCR_HEIGHT);
-void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
-{
-	float xpos = static_cast<float>(xposIn);
-	float ypos = static_cast<float>(yposIn);
-
-	if (firstMouse)
-	{
-		lastX = xpos;
-		lastY = ypos;
-		firstMouse = false;
-	}
-
-	float xoffset = xpos - lastX;
-	float yoffset = lastY - ypos; // reversed since y-coordinates go from bottom to top
-	lastX = xpos;
-	lastY = ypos;
-
-	float sensitivity = 0.1f; // change this value to your liking
-	xoffset *= sensitivity;
-	yoffset *= sensitivity;
-
-	camera.rotate(yoffset, xoffset);
-}
-
-void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
-{
-	camera.zoom((float)-yoffset);
-}
-
-const char* vertexShaderSource = "#version 330 core\n"
-"layout (location = 0) in vec3 aPos;           \n"
-"layout (location = 1) in vec2 aTexCoord;      \n"
-"                                              \n"
-"out vec2 TexCoord;                            \n"
-"uniform mat4 model;                           \n"
-"uniform mat4 view;                            \n"
-"uniform mat4 projection;                      \n"
-"                                              \n"
-"void main()                                   \n"
-"{                                             \n"
-"	gl_Position = projection * view * model * vec4(aPos, 1.0);             \n"
-"	TexCoord = vec2(aTexCoord.x, aTexCoord.y); \n"
-"}                                             \n";
-
-const char* fragmentShaderSource = "#version 330 core\n"
-"out vec4 FragColor;\n"
-"\n"
-"in vec2 TexCoord;\n"
-"\n"
-"uniform sampler2D texture1;\n"
-"uniform sampler2D texture2;\n"
-"void main()\n"
-"{\n"
-"    FragColor = mix(texture(texture1, TexCoord), texture(texture2, TexCoord), 0.2);\n"
-"}\n";
-
-void GLAPIENTRY MessageCallback(GLenum source,
-	GLenum type,
-	GLuint id,
-	GLenum severity,
-	GLsizei length,
-	const GLchar* message,
-	const void* userParam)
-{
-	fprintf(stderr, "GL CALLBACK: %s type = 0x%x, severity = 0x%x, message = %s\n",
-		(type == GL_DEBUG_TYPE_ERROR ? "** GL ERROR **" : ""),
-		type, severity, message);
-}
-
-int main(int argc, char** argv)
-{
-    // glfw: initialize and configure
-    // ------------------------------
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-#ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#endif
-
-    // glfw window creation
-    // --------------------
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
-    if (window == NULL)
-    {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
-    }
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-    glfwSetCursorPosCallback(window, mouse_callback);
-
-    glfwSetScrollCallback(window, scroll_callback);
-
-    // glad: load all OpenGL function pointers
-    // ---------------------------------------
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
-    {
-        std::cout << "Failed to initialize GLAD" << std::endl;
-        return -1;
-    }
-
-	// During init, enable debug output
-    glimplify::context context(MessageCallback);
-
-    // build and compile our shader program
-    // ------------------------------------
-    // vertex shader
-    char desc[512] = { 0 };
-    glimplify::program program;
-    if (!program.compile(vertexShaderSource, fragmentShaderSource, 512, desc))
-    {
-        fprintf(stderr, "compile shader failed: %s\n", desc);
-    }
-
-    program.bind();
-	program.set_uniform_1i("texture1", 0);
-	program.set_uniform_1i("texture2", 1);
-    program.unbind();
-
-    // set up vertex data (and buffer(s)) and configure vertex attributes
-    // ------------------------------------------------------------------
-    float vertices_data[] = {
-		 -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
-		 0.5f, -0.5f, -0.5f,  1.0f, 0.0f,
-		 0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-		 0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-		-0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
-		-0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
-
-		-0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-		 0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
-		 0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
-		 0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
-		-0.5f,  0.5f,  0.5f,  0.0f, 1.0f,
-		-0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-
-		-0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-		-0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-		-0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-		-0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-		-0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-		-0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-
-		 0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-		 0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-		 0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-		 0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-		 0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-		 0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-
-		-0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-		 0.5f, -0.5f, -0.5f,  1.0f, 1.0f,
-		 0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
-		 0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
-		-0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-		-0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-
-		-0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
-		 0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-		 0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-		 0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-		-0.5f,  0.5f,  0.5f,  0.0f, 0.0f,
-		-0.5f,  0.5f, -0.5f,  0.0f, 1.0f
-    };
-    unsigned int indices_data[] = {  // note that we start from 0!
-		0, 1, 3, // first triangle
-		1, 2, 3  // second triangle
-    };
-    
-    glimplify::vertices vertices(2, 5 * sizeof(float));
-    
-    vertices.bind();
-    vertices.allocate_vertices(sizeof(vertices_data), vertices_data, GL_STATIC_DRAW);
-	vertices.allocate_index(sizeof(indices_data), indices_data, GL_STATIC_DRAW);
-    vertices.format_vertices(0, GL_FLOAT, 3);
-	vertices.format_vertices(1, GL_FLOAT, 2);
-    vertices.unbind();
-
-    glimplify::texture text1(0), text2(1);
-
-	text1.bind();
-	text1.wrap_mode(GL_REPEAT, GL_REPEAT);
-	text1.filter_mode(GL_LINEAR, GL_LINEAR);
-    text1.load("E:/images/container.jpg", true, true);
-    text1.unbind();
-
-	text2.bind();
-	text2.wrap_mode(GL_REPEAT, GL_REPEAT);
-	text2.filter_mode(GL_LINEAR, GL_LINEAR);
-	text2.load("E:/images/awesomeface.png", true, true);
-	text2.unbind();
-    
-    // uncomment this call to draw in wireframe polygons.
-    //context.wireframe_mode();
-    context.testing_depth();
-
-    float radius = 10.0f;
-    camera.move_to(glm::vec3(0.0f, 0.0f, 20.0f));
-
-	glm::mat4 model = glm::rotate(glm::mat4(1.0f), glm::radians(55.0f), glm::vec3(1.0f, 1.0f, 1.0f));
-
-    // render loop
-    // -----------
-    lastFrame = glfwGetTime();
-    while (!glfwWindowShouldClose(window))
-	{
-        // input
-        // -----
-        processInput(window, camera);
-
-        // render
-        // ------
-        context.clear(0.2f, 0.3f, 0.3f, 1.0f);
-
-        // draw our first triangle
-        program.bind();
-		program.set_uniform_matrix4fv("model", model);
-		program.set_uniform_matrix4fv("view", camera.view_matrix());
-		program.set_uniform_matrix4fv("projection", camera.perspective_matrix());
-
-        text1.bind();
-        text2.bind();
-
-        vertices.bind(); 
-
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        //glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-
-		vertices.unbind();
-
-		text2.unbind();
-		text1.unbind();
-
-        program.unbind();
-
-        // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-        // -------------------------------------------------------------------------------
-        glfwSwapBuffers(window);
-        glfwPollEvents();
-    }
-
-    // glfw: terminate, clearing all previously allocated GLFW resources.
-    // ------------------------------------------------------------------
-    glfwTerminate();
-
-    scanf("%d", &argc);
-
-    return 0;
-}
-
-// glfw: whenever the window size changed (by OS or user resize) this callback function executes
-// ---------------------------------------------------------------------------------------------
-void framebuffer_size_callback(GLFWwindow* window, int width, int height)
-{
-    // make sure the viewport matches the new window dimensions; note that width and 
-    // height will be significantly larger than specified on retina displays.
-    glViewport(0, 0, width, height);
-}
+
+
+#include "vertices.hpp"
+#include "quantize.hpp"
+#include "program.hpp"
+#include "hot_program.hpp"
+
+#include "texture.hpp"
+
+#include "camera.hpp"
+
+#include "context.hpp"
+#include "frame_loop.hpp"
+#include "input.hpp"
+
+#include <GLFW/glfw3.h>
+
+#include <iostream>
+
+// settings
+const unsigned int SCR_WIDTH = 800;
+const unsigned int SCR_HEIGHT = 600;
+
+void framebuffer_size_callback(GLFWwindow* window, int width, int height);
+
+
+// the callbacks only queue what happened, the camera changes once per frame and once per simulation step
+glimplify::input inputEvents;
+
+// process all input: the mouse look of the frame is applied together with the first step's movement
+// --------------------------------------------------------------------------------------------------
+void processInput(glimplify::camera& camera, float deltaTime, const glm::vec2& look)
+{
+	auto axis = [](int positive, int negative) {
+		return (inputEvents.down(positive) ? 1.0f : 0.0f) - (inputEvents.down(negative) ? 1.0f : 0.0f);
+	};
+
+	// x right, y up, z forward; free flight: q/e roll, space/left control move along the camera up
+	glm::vec3 move(axis(GLFW_KEY_D, GLFW_KEY_A), axis(GLFW_KEY_SPACE, GLFW_KEY_LEFT_CONTROL), axis(GLFW_KEY_W, GLFW_KEY_S));
+	float roll = 90.0f * axis(GLFW_KEY_E, GLFW_KEY_Q) * deltaTime;
+
+	camera.transform(move * deltaTime, look.y, look.x, roll);
+}
+
+glimplify::camera camera(SCR_WIDTH, SCR_HEIGHT);
+void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
+{
+	inputEvents.cursor(xposIn, yposIn);
+}
+
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	inputEvents.key(key, action);
+}
+
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
+{
+	inputEvents.scroll(xoffset, yoffset);
+}
+
+const char* vertexShaderSource = "#version 330 core\n"
+"layout (location = 0) in vec3 aPos;           \n"
+"layout (location = 1) in vec2 aTexCoord;      \n"
+"                                              \n"
+"out vec2 TexCoord;                            \n"
+"uniform mat4 model;                           \n"
+"uniform mat4 view;                            \n"
+"uniform mat4 projection;                      \n"
+"                                              \n"
+"void main()                                   \n"
+"{                                             \n"
+"	gl_Position = projection * view * model * vec4(aPos, 1.0);             \n"
+"	TexCoord = vec2(aTexCoord.x, aTexCoord.y); \n"
+"}                                             \n";
+
+const char* fragmentShaderSource = "#version 330 core\n"
+"out vec4 FragColor;\n"
+"\n"
+"in vec2 TexCoord;\n"
+"\n"
+"uniform sampler2D texture1;\n"
+"uniform sampler2D texture2;\n"
+"void main()\n"
+"{\n"
+"    FragColor = mix(texture(texture1, TexCoord), texture(texture2, TexCoord), 0.2);\n"
+"}\n";
+
+void GLAPIENTRY MessageCallback(GLenum source,
+	GLenum type,
+	GLuint id,
+	GLenum severity,
+	GLsizei length,
+	const GLchar* message,
+	const void* userParam)
+{
+	fprintf(stderr, "GL CALLBACK: %s type = 0x%x, severity = 0x%x, message = %s\n",
+		(type == GL_DEBUG_TYPE_ERROR ? "** GL ERROR **" : ""),
+		type, severity, message);
+}
+
+int main(int argc, char** argv)
+{
+    // glfw: initialize and configure
+    // ------------------------------
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+    // glfw window creation
+    // --------------------
+    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+    if (window == NULL)
+    {
+        std::cout << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    glfwSetCursorPosCallback(window, mouse_callback);
+
+    glfwSetScrollCallback(window, scroll_callback);
+    glfwSetKeyCallback(window, key_callback);
+
+    // glad: load all OpenGL function pointers
+    // ---------------------------------------
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return -1;
+    }
+
+	// During init, enable debug output
+    glimplify::context context(MessageCallback);
+
+    // build and compile our shader program
+    // ------------------------------------
+    // vertex shader
+    char desc[512] = { 0 };
+    std::unique_ptr<glimplify::program> inline_program;
+
+    // glimplify vertex.glsl fragment.glsl loads the shaders from files and reloads them when they are saved
+    glimplify::file_watcher watcher;
+    std::unique_ptr<glimplify::hot_program> hot;
+    if (argc >= 3)
+    {
+        hot.reset(new glimplify::hot_program(watcher, argv[1], argv[2]));
+        if (!hot->load(512, desc))
+        {
+            fprintf(stderr, "compile shader failed: %s\n", desc);
+        }
+        watcher.start();
+    }
+    else
+    {
+        // the built-in shaders only when no files are given
+        inline_program.reset(new glimplify::program());
+        if (!inline_program->compile(vertexShaderSource, fragmentShaderSource, 512, desc))
+        {
+            fprintf(stderr, "compile shader failed: %s\n", desc);
+        }
+    }
+
+    glimplify::program& program = hot ? hot->get() : *inline_program;
+
+    // only the bind-to-edit fallback needs the program bound to set uniforms
+    program.bind();
+	program.set_uniform_1i("texture1", 0);
+	program.set_uniform_1i("texture2", 1);
+    program.unbind();
+
+    // set up vertex data (and buffer(s)) and configure vertex attributes
+    // ------------------------------------------------------------------
+    float vertices_data[] = {
+		 -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
+		 0.5f, -0.5f, -0.5f,  1.0f, 0.0f,
+		 0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+		 0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+		-0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
+		-0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
+
+		-0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+		 0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
+		 0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
+		 0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
+		-0.5f,  0.5f,  0.5f,  0.0f, 1.0f,
+		-0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+
+		-0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+		-0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+		-0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+		-0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+		-0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+		-0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+
+		 0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+		 0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+		 0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+		 0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+		 0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+		 0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+
+		-0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+		 0.5f, -0.5f, -0.5f,  1.0f, 1.0f,
+		 0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
+		 0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
+		-0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+		-0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+
+		-0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
+		 0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+		 0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+		 0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+		-0.5f,  0.5f,  0.5f,  0.0f, 0.0f,
+		-0.5f,  0.5f, -0.5f,  0.0f, 1.0f
+    };
+    // quantize the float cube into half positions and 16 bit texture coordinates, 12 bytes per vertex instead of 20
+    struct cube_vertex
+    {
+        glimplify::half4 position;
+        glimplify::unorm16x2 coordinate;
+    };
+
+    using cube_layout = glimplify::layout<glimplify::attr<glimplify::half4>, glimplify::attr<glimplify::unorm16x2>>;
+    static_assert(cube_layout::matches<cube_vertex>(), "cube vertex is half position + unorm16 texture coordinate");
+
+    const size_t cube_vertex_count = sizeof(vertices_data) / (5 * sizeof(float));
+
+    cube_vertex cube_vertices[cube_vertex_count] = {};
+    glimplify::quantize_half(vertices_data, 5 * sizeof(float), 3, cube_vertex_count, &cube_vertices[0].position.x, sizeof(cube_vertex));
+    glimplify::quantize_unorm16(vertices_data + 3, 5 * sizeof(float), 2, cube_vertex_count, &cube_vertices[0].coordinate.x, sizeof(cube_vertex));
+
+    // the cube is a list of 36 vertices, share the 24 unique ones through 16 bit indices
+    glimplify::indexed_mesh cube = glimplify::optimize_mesh(cube_vertices, cube_vertex_count, sizeof(cube_vertex));
+    glimplify::index_buffer cube_indices = glimplify::narrow_indices(cube.indices.data(), cube.indices.size());
+
+    // no bind needed for setup, the wrappers edit by name with direct state access or bind what they edit
+    glimplify::vertices vertices;
+    vertices.allocate_vertices(cube.vertices.size(), cube.vertices.data(), GL_STATIC_DRAW);
+	vertices.allocate_index(cube_indices, GL_STATIC_DRAW);
+    vertices.format_vertices<cube_layout>();
+
+    if (!program.reflection().matches<cube_layout>(0, 512, desc))
+    {
+        fprintf(stderr, "vertex layout doesn't match the program: %s\n", desc);
+    }
+
+    glimplify::texture text1(0), text2(1);
+
+	text1.wrap_mode(GL_REPEAT, GL_REPEAT);
+	text1.filter_mode(GL_LINEAR, GL_LINEAR);
+    text1.load("E:/images/container.jpg", true, true);
+
+	text2.wrap_mode(GL_REPEAT, GL_REPEAT);
+	text2.filter_mode(GL_LINEAR, GL_LINEAR);
+	text2.load("E:/images/awesomeface.png", true, true);
+    
+    // uncomment this call to draw in wireframe polygons.
+    //context.wireframe_mode();
+    context.testing_depth();
+
+    // reverse-z with an infinite far plane into a float depth buffer, the 3.3 context needs GL_ARB_clip_control for it
+    int targetWidth = SCR_WIDTH, targetHeight = SCR_HEIGHT;
+    if (context.reverse_depth())
+    {
+        camera.depth(glimplify::depth_convention::reverse);
+        context.float_depth(targetWidth, targetHeight);
+    }
+
+    float radius = 10.0f;
+    camera.move_to(glm::vec3(0.0f, 0.0f, 20.0f));
+
+	glm::mat4 model = glm::rotate(glm::mat4(1.0f), glm::radians(55.0f), glm::vec3(1.0f, 1.0f, 1.0f));
+
+    // render loop
+    // -----------
+    // the camera moves in fixed steps, frames render in between the last two of them
+    glimplify::frame_loop loop(1.0 / 120.0);
+    glm::vec3 previousPosition = camera.position();
+    loop.reset();
+    while (!glfwWindowShouldClose(window))
+	{
+        // input
+        // -----
+        inputEvents.update();
+
+        if (inputEvents.pressed(GLFW_KEY_ESCAPE))
+            glfwSetWindowShouldClose(window, true);
+
+        // tab toggles the quaternion free flight mode
+        if (inputEvents.pressed(GLFW_KEY_TAB))
+            camera.mode(glimplify::camera::orientation::free == camera.mode() ? glimplify::camera::orientation::euler : glimplify::camera::orientation::free);
+
+        if (inputEvents.scroll().y != 0.0f)
+            camera.zoom(-inputEvents.scroll().y);
+
+        // degrees of yaw and pitch, the cursor y goes down the screen
+        float sensitivity = 0.1f; // change this value to your liking
+        glm::vec2 look(inputEvents.cursor_delta().x * sensitivity, -inputEvents.cursor_delta().y * sensitivity);
+
+        for (GLuint steps = loop.begin_frame(); steps > 0; --steps)
+        {
+            previousPosition = camera.position();
+            processInput(camera, static_cast<float>(loop.step()), look);
+            look = glm::vec2(0.0f);
+        }
+
+        // no step this frame, still turn right away
+        if (look.x != 0.0f || look.y != 0.0f)
+            camera.transform(glm::vec3(0.0f), look.y, look.x);
+
+        // never waits for the compiler, a failed edit keeps drawing with the last working program
+        if (hot)
+        {
+            switch (hot->update(512, desc))
+            {
+            case glimplify::hot_program::status::swapped: fprintf(stdout, "shaders reloaded\n"); break;
+            case glimplify::hot_program::status::failed: fprintf(stderr, "reload shader failed: %s\n", desc); break;
+            default: break;
+            }
+        }
+
+        // render
+        // ------
+        // the offscreen float depth target follows the window size
+        int width = 0, height = 0;
+        glfwGetFramebufferSize(window, &width, &height);
+        if (context.framebuffer() && width > 0 && height > 0 && (width != targetWidth || height != targetHeight))
+        {
+            targetWidth = width;
+            targetHeight = height;
+            context.float_depth(targetWidth, targetHeight);
+        }
+
+        // the cpu stays at most frames_in_flight() frames ahead of the gpu
+        context.begin_frame();
+        context.clear(0.2f, 0.3f, 0.3f, 1.0f);
+
+        // draw our first triangle
+        program.bind();
+		program.set_uniform_matrix4fv("model", model);
+		program.set_uniform_matrix4fv("view", camera.interpolated_view(previousPosition, camera.rotation(), loop.alpha()));
+		program.set_uniform_matrix4fv("projection", camera.perspective_matrix());
+
+        text1.bind();
+        text2.bind();
+
+        vertices.bind(); 
+
+        glDrawElements(GL_TRIANGLES, cube_indices.count, cube_indices.type, 0);
+
+		vertices.unbind();
+
+		text2.unbind();
+		text1.unbind();
+
+        program.unbind();
+
+        // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+        // -------------------------------------------------------------------------------
+        context.present();
+        context.end_frame();
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+
+        loop.end_frame();
+    }
+
+    // glfw: terminate, clearing all previously allocated GLFW resources.
+    // ------------------------------------------------------------------
+    glfwTerminate();
+
+    scanf("%d", &argc);
+
+    return 0;
+}
+
+// glfw: whenever the window size changed (by OS or user resize) this callback function executes
+// ---------------------------------------------------------------------------------------------
+void framebuffer_size_callback(GLFWwindow* window, int width, int height)
+{
+    // make sure the viewport matches the new window dimensions; note that width and 
+    // height will be significantly larger than specified on retina displays.
+    glViewport(0, 0, width, height);
+}
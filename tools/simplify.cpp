@@ -0,0 +1,117 @@
+
+// offline level of detail generation: simplify <input.obj> <output.lod> [levels] [reduction] [max error]
+//
+// reads the positions and faces of a wavefront obj, polygons are fanned into triangles, and writes
+// the position only vertices with every level's indices in the format of glimplify::load_lod_mesh.
+
+#include "lod.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static bool read_obj(const char* path, std::vector<float>& positions, std::vector<GLuint>& indices)
+{
+	std::ifstream stream(path);
+	if (!stream)
+	{
+		return false;
+	}
+
+	std::string line;
+	while (std::getline(stream, line))
+	{
+		std::istringstream tokens(line);
+		std::string kind;
+		tokens >> kind;
+
+		if ("v" == kind)
+		{
+			float x = 0.0f, y = 0.0f, z = 0.0f;
+			tokens >> x >> y >> z;
+			positions.push_back(x);
+			positions.push_back(y);
+			positions.push_back(z);
+		}
+		else if ("f" == kind)
+		{
+			// "f 1/2/3 4//6 7 ..." only the position index before the first slash matters, negative ones are relative
+			std::vector<GLuint> polygon;
+			std::string corner;
+			while (tokens >> corner)
+			{
+				long index = strtol(corner.c_str(), nullptr, 10);
+				index = index < 0 ? static_cast<long>(positions.size() / 3) + index : index - 1;
+				if (index < 0 || index >= static_cast<long>(positions.size() / 3))
+				{
+					return false;
+				}
+				polygon.push_back(static_cast<GLuint>(index));
+			}
+
+			for (size_t i = 2; i < polygon.size(); ++i)
+			{
+				indices.push_back(polygon[0]);
+				indices.push_back(polygon[i - 1]);
+				indices.push_back(polygon[i]);
+			}
+		}
+	}
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		fprintf(stderr, "usage: %s <input.obj> <output.lod> [levels = 6] [reduction = 0.5] [max error = 1e30]\n", argv[0]);
+		return 1;
+	}
+
+	size_t levels = argc > 3 ? strtoul(argv[3], nullptr, 10) : 6;
+	float reduction = argc > 4 ? static_cast<float>(atof(argv[4])) : 0.5f;
+	float max_error = argc > 5 ? static_cast<float>(atof(argv[5])) : 1e30f;
+
+	std::vector<float> positions;
+	std::vector<GLuint> indices;
+	if (!read_obj(argv[1], positions, indices) || indices.empty())
+	{
+		fprintf(stderr, "read %s failed\n", argv[1]);
+		return 1;
+	}
+
+	glimplify::lod_mesh result;
+	result.mesh.stride = 3 * sizeof(float);
+
+	// level 0 in cache friendly order, then the vertices in the order it fetches them, the other levels reuse them
+	size_t vertex_count = positions.size() / 3;
+	float acmr_before = glimplify::acmr(indices.data(), indices.size(), vertex_count);
+	glimplify::optimize_vertex_cache(indices.data(), indices.size(), vertex_count);
+	fprintf(stdout, "vertex cache: acmr %f -> %f\n", acmr_before, glimplify::acmr(indices.data(), indices.size(), vertex_count));
+
+	result.mesh.vertices.resize(positions.size() * sizeof(float));
+	memcpy(result.mesh.vertices.data(), positions.data(), result.mesh.vertices.size());
+	result.mesh.vertex_count = glimplify::optimize_vertex_fetch(indices.data(), indices.size(), result.mesh.vertices.data(), vertex_count, result.mesh.stride);
+	result.mesh.vertices.resize(result.mesh.vertex_count * result.mesh.stride);
+
+	result.chain = glimplify::build_lod_chain(indices.data(), indices.size(), result.mesh.vertices.data(), result.mesh.vertex_count, result.mesh.stride,
+		levels, reduction, max_error, result.mesh.indices);
+
+	for (size_t i = 0; i < result.chain.levels.size(); ++i)
+	{
+		const glimplify::lod_level& level = result.chain.levels[i];
+		fprintf(stdout, "level %u: %u triangles, error %f\n", (unsigned int)i, (unsigned int)(level.index_count / 3), level.error);
+	}
+
+	if (!glimplify::save_lod_mesh(argv[2], result))
+	{
+		fprintf(stderr, "write %s failed\n", argv[2]);
+		return 1;
+	}
+
+	return 0;
+}